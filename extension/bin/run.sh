@@ -15,12 +15,34 @@ do
 echo
 echo
 
-echo "Please input a number(1~6) to run a test, Ctrl-d to exit:"
+echo "Please input a number(1~27) to run a test, Ctrl-d to exit:"
 echo " 		1 for test1.c -- test struct type"
 echo " 		2 for test2.c -- test pointer type"
 echo " 		3 for test3.c -- test function pointer"
 echo " 		4 for sort.c  -- use different compare function to sort an array of struct pointers"
 echo " 		5 for type.c  -- print types"
+echo " 		6 for fold.c  -- test constant folding"
+echo " 		7 for loop.c  -- test for loops, break and continue"
+echo " 		8 for leaks   -- compile every test 100000 times, memory must stay flat"
+echo " 		9 for return.c -- test return values converted to the return type"
+echo " 		10 for tbaa.c -- test TBAA tags on struct members"
+echo " 		11 for abi.c  -- test passing structs to and from C"
+echo " 		12 for typecache.c -- test types written out in several places"
+echo " 		13 for annotate.c -- test checker results kept beside the tree"
+echo " 		14 for fused.c -- test checking and generating code in one pass"
+echo " 		15 for scopes.c -- test 40 nested scopes and shadowing"
+echo " 		16 for binding.c -- test names bound to their declarations"
+echo " 		17 for layout.c -- test struct layouts and member indices"
+echo " 		18 for parallel.c -- test that checking in parallel reports what the serial checker does"
+echo " 		19 for incremental.c -- compile, edit and compile again with -i, unchanged bodies come from the old .ll"
+echo " 		20 for effects.c -- test function attributes from the effect analysis, optimized with opt -O2"
+echo " 		21 for dce.c  -- test that functions and globals main does not reach are left out"
+echo " 		22 for unreachable.c -- test warnings for code that can never run"
+echo " 		23 for cond.c -- test short-circuit conditions lowered to branches"
+echo " 		24 for nsw.c  -- test nsw arithmetic and inbounds array items, optimized with opt -O2"
+echo " 		25 for arrayinit.c -- test local arrays initialized with memcpy and memset"
+echo " 		26 for globals.c -- test zero-initialized and sparse global arrays"
+echo " 		27 for samename1.c and samename2.c -- compile two files with a different struct node in one process"
 
 read choice
 
@@ -52,6 +74,156 @@ case $choice in
 	5)
 		bin/compiler  -t test/type.c 
 		;;
+	6)
+		bin/compiler test/fold.c 
+		llc -filetype=obj fold.ll -o bin/fold.o
+		clang bin/fold.o bin/libexternfunc.so -o fold
+		./fold
+		;;
+	7)
+		bin/compiler test/loop.c 
+		llc -filetype=obj loop.ll -o bin/loop.o
+		clang bin/loop.o bin/libexternfunc.so -o loop
+		./loop
+		;;
+	8)
+		for f in test1 test2 test3 sort fold loop return tbaa abi typecache annotate fused scopes binding layout effects dce unreachable cond nsw arrayinit globals
+		do
+			echo $f.c
+			bin/compiler -r 100000 test/$f.c | tail -2
+		done
+		;;
+	9)
+		bin/compiler test/return.c 
+		llc -filetype=obj return.ll -o bin/return.o
+		clang bin/return.o bin/libexternfunc.so -o return
+		./return
+		;;
+	10)
+		bin/compiler test/tbaa.c 
+		llc -filetype=obj tbaa.ll -o bin/tbaa.o
+		clang bin/tbaa.o bin/libexternfunc.so -o tbaa
+		./tbaa
+		;;
+	11)
+		bin/compiler test/abi.c 
+		llc -filetype=obj abi.ll -o bin/abi.o
+		clang bin/abi.o bin/libexternfunc.so -o abi
+		./abi
+		;;
+	12)
+		bin/compiler test/typecache.c 
+		llc -filetype=obj typecache.ll -o bin/typecache.o
+		clang bin/typecache.o bin/libexternfunc.so -o typecache
+		./typecache
+		;;
+	13)
+		bin/compiler test/annotate.c 
+		llc -filetype=obj annotate.ll -o bin/annotate.o
+		clang bin/annotate.o bin/libexternfunc.so -o annotate
+		./annotate
+		;;
+	14)
+		bin/compiler -f test/fused.c 
+		llc -filetype=obj fused.ll -o bin/fused.o
+		clang bin/fused.o bin/libexternfunc.so -o fused
+		./fused
+		;;
+	15)
+		bin/compiler test/scopes.c 
+		llc -filetype=obj scopes.ll -o bin/scopes.o
+		clang bin/scopes.o bin/libexternfunc.so -o scopes
+		./scopes
+		;;
+	16)
+		bin/compiler test/binding.c 
+		llc -filetype=obj binding.ll -o bin/binding.o
+		clang bin/binding.o bin/libexternfunc.so -o binding
+		./binding
+		;;
+	17)
+		bin/compiler test/layout.c 
+		llc -filetype=obj layout.ll -o bin/layout.o
+		clang bin/layout.o bin/libexternfunc.so -o layout
+		./layout
+		;;
+	18)
+		bin/compiler test/parallel.c
+		bin/compiler -t test/parallel.c | tail -6
+		;;
+	19)
+		rm -f incremental.ll incremental.deps
+		cp test/incremental.c bin/incremental.c
+		bin/compiler -i bin/incremental.c
+		llc -filetype=obj incremental.ll -o bin/incremental.o
+		clang bin/incremental.o bin/libexternfunc.so -o incremental
+		./incremental
+		sed -i 's/1111/2222/g' incremental.ll
+		sed -i 's/3333/4444/; s/K = 5/K = 6/' bin/incremental.c
+		bin/compiler -i bin/incremental.c
+		llc -filetype=obj incremental.ll -o bin/incremental.o
+		clang bin/incremental.o bin/libexternfunc.so -o incremental
+		./incremental
+		;;
+	20)
+		bin/compiler test/effects.c 
+		grep "^define\|^attributes" effects.ll
+		opt -O2 -S effects.ll -o effects.opt.ll
+		llc -filetype=obj effects.opt.ll -o bin/effects.o
+		clang bin/effects.o bin/libexternfunc.so -o effects
+		./effects
+		;;
+	21)
+		bin/compiler test/dce.c 
+		grep "^define\|^@" dce.ll
+		llc -filetype=obj dce.ll -o bin/dce.o
+		clang bin/dce.o bin/libexternfunc.so -o dce
+		./dce
+		;;
+	22)
+		bin/compiler test/unreachable.c 
+		llc -filetype=obj unreachable.ll -o bin/unreachable.o
+		clang bin/unreachable.o bin/libexternfunc.so -o unreachable
+		./unreachable
+		;;
+	23)
+		bin/compiler test/cond.c 
+		llc -filetype=obj cond.ll -o bin/cond.o
+		clang bin/cond.o bin/libexternfunc.so -o cond
+		./cond
+		;;
+	24)
+		bin/compiler test/nsw.c 
+		opt -O2 -S nsw.ll -o nsw.opt.ll
+		llc -filetype=obj nsw.opt.ll -o bin/nsw.o
+		clang bin/nsw.o bin/libexternfunc.so -o nsw
+		./nsw
+		;;
+	25)
+		bin/compiler test/arrayinit.c 
+		llc -filetype=obj arrayinit.ll -o bin/arrayinit.o
+		clang bin/arrayinit.o bin/libexternfunc.so -o arrayinit
+		./arrayinit
+		bin/compiler test/arrayinit_long.c
+		;;
+	26)
+		bin/compiler test/globals.c 
+		grep "^@" globals.ll
+		llc -filetype=obj globals.ll -o bin/globals.o
+		clang bin/globals.o bin/libexternfunc.so -o globals
+		./globals
+		bin/compiler test/globals_long.c
+		;;
+	27)
+		bin/compiler -r 1000 test/samename1.c test/samename2.c | tail -2
+		for f in samename1 samename2
+		do
+			llc -filetype=obj $f.ll -o bin/$f.o
+			clang bin/$f.o bin/libexternfunc.so -o $f
+			./$f
+		done
+		bin/compiler test/samename_redef.c
+		;;
 
 	*)
 		echo $choice: unknown option
@@ -15,6 +15,7 @@ extern int yylex();
 extern int yyerror(const char *msg);
 
 extern MsgFactory msgFactory;
+extern unsigned int yyoffset;
 
 extern CompUnitNode *root;
 extern bool errorFlag;
@@ -27,6 +28,16 @@ static void setAtomType(ValueTypeS *pType, ValueTypeS atomTy);
 
 %}
 
+%code requires {
+#include "node.h"
+
+// a location is just the byte offset of the first character (see SrcLoc)
+#define YYLTYPE SrcLoc
+#define YYLTYPE_IS_DECLARED 1
+#define YYLLOC_DEFAULT(Current, Rhs, N) \
+	((Current) = (N) ? YYRHSLOC(Rhs, 1) : YYRHSLOC(Rhs, 0))
+}
+
 %debug
 %expect 1
 
@@ -34,6 +45,7 @@ static void setAtomType(ValueTypeS *pType, ValueTypeS atomTy);
 %initial-action 
 {
     msgFactory.initial(infile_name);	
+	yyoffset = 0;
 	yydebug = 0;
 };
 
@@ -54,8 +66,9 @@ static void setAtomType(ValueTypeS *pType, ValueTypeS atomTy);
 
 
 %token CONST INTTYPE FLOATTYPE CHARTYPE EXTERN STATIC
-%token IF ELSE WHILE VOID ID NUM FNUM CHAR RETURN BREAK CONTINUE STRUCT 
-%token ASIGN LBRACE RBRACE LBRACKET RBRACKET LPARENT RPARENT 
+%token IF ELSE WHILE FOR VOID ID NUM FNUM CHAR RETURN BREAK CONTINUE STRUCT 
+%token ASIGN ADD_ASIGN SUB_ASIGN MULT_ASIGN DIV_ASIGN MOD_ASIGN INC DEC
+%token LBRACE RBRACE LBRACKET RBRACKET LPARENT RPARENT 
 %token COMMA SEMICOLON  
 
 %precedence NO_ELSE
@@ -85,7 +98,7 @@ static void setAtomType(ValueTypeS *pType, ValueTypeS atomTy);
 %type <name> ID
 %type <node> CompUnit CompUnitItem FuncDef FunCall LVal Exp 
 %type <node> ExternDecl StaticDecl VarDecl VarDef AssignedVar StructDef
-%type <node> Block BlockItem Stmt Cond 
+%type <node> Block BlockItem Stmt SimpleStmt ForInit ForStep Cond ForCond 
 %type <nodeList> ExpList VarList BlockItemList ArgNameList ArraySuffix
 %type <vType> Type
 %type <var> Var
@@ -100,7 +113,7 @@ CompUnit: CompUnitItem
 			{
 				if (!errorFlag) {
 					root = new CompUnitNode($1);
-					root->setLoc((Loc*)&(@$));
+					root->setLoc(@$);
 					astNodes.push_back(root);
 				}
 			}
@@ -108,7 +121,7 @@ CompUnit: CompUnitItem
 			{
 				if (!errorFlag) {
 					root->append($2);
-					root->setLoc((Loc*)&(@$));
+					root->setLoc(@$);
 				}
 			}
 		;
@@ -151,7 +164,7 @@ LVal: ID
 		{
 			if (!errorFlag) {
 				$$ = new IdNode($1);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 			else {
@@ -162,7 +175,7 @@ LVal: ID
 		{
 			if (!errorFlag) {
 				$$ = new ArrayItemNode((ExpNode*)$1, $2);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -170,7 +183,7 @@ LVal: ID
 		{
 			if (!errorFlag) {
 			 	$$ = new UnaryExpNode('*', (ExpNode*)$2);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -179,17 +192,23 @@ LVal: ID
 		{
 			if (!errorFlag) {
 				$$ = new StructItemNode((ExpNode*)$1, $3, false); 
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
+			else {
+				delete $3;
+			}
 		}
 	| Exp ARROW ID
 		{
 			if (!errorFlag) {
 				$$ = new StructItemNode((ExpNode*)$1, $3, true); 
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
+			else {
+				delete $3;
+			}
 		}
 
 	;
@@ -204,7 +223,7 @@ Exp: LVal
    		{
 			if (!errorFlag) {
 				$$ = new NumNode($1);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -212,7 +231,7 @@ Exp: LVal
    		{
 			if (!errorFlag) {
 				$$ = new FNumNode($1);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -220,7 +239,7 @@ Exp: LVal
    		{
 			if (!errorFlag) {
 				$$ = new CharNode($1);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -229,14 +248,14 @@ Exp: LVal
    		{
 			if (!errorFlag) {
 				$$ = $1;
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 			}
 		}
    | LPARENT Exp RPARENT 
    		{
 			if (!errorFlag) {
 				$$ = $2;
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 			}
 		}
 
@@ -244,7 +263,7 @@ Exp: LVal
    		{
 			if (!errorFlag) {
 				$$ = new BinaryExpNode('+', (ExpNode*)$1, (ExpNode*)$3);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -252,7 +271,7 @@ Exp: LVal
    		{
 			if (!errorFlag) {
 				$$ = new BinaryExpNode('-', (ExpNode*)$1, (ExpNode*)$3);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -260,7 +279,7 @@ Exp: LVal
    		{
 			if (!errorFlag) {
 				$$ = new BinaryExpNode('*', (ExpNode*)$1, (ExpNode*)$3);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -268,7 +287,7 @@ Exp: LVal
    		{
 			if (!errorFlag) {
 				$$ = new BinaryExpNode('/', (ExpNode*)$1, (ExpNode*)$3);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -276,7 +295,7 @@ Exp: LVal
    		{
 			if (!errorFlag) {
 				$$ = new BinaryExpNode('%', (ExpNode*)$1, (ExpNode*)$3);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -285,7 +304,7 @@ Exp: LVal
    		{
 			if (!errorFlag) {
 				$$ = new UnaryExpNode('+', (ExpNode*)$2);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -293,7 +312,7 @@ Exp: LVal
    		{
 			if (!errorFlag) {
 			 	$$ = new UnaryExpNode('-', (ExpNode*)$2);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -301,7 +320,7 @@ Exp: LVal
 		{
 			if (!errorFlag) {
 			 	$$ = new UnaryExpNode('&', (ExpNode*)$2);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -311,7 +330,7 @@ ExpList: Exp
 	   		{
 				if (!errorFlag) {
 					$$ = new NodeList($1);
-					$$->setLoc((Loc*)&(@$));
+					$$->setLoc(@$);
 					astNodes.push_back($$);
 				}
 			}
@@ -320,7 +339,7 @@ ExpList: Exp
 				if (!errorFlag) {
 					$1->append($3);
 					$$ = $1;
-					$$->setLoc((Loc*)&(@$));
+					$$->setLoc(@$);
 				}
 			}
 	   ;
@@ -345,7 +364,7 @@ Type: INTTYPE
 		{
 			if (!errorFlag) {
 				$$.type = STRUCT_TYPE;
-				$$.structName = $2;
+				$$.structName = adoptTypeName($2);
 			}
 			else {
 				delete $2;
@@ -369,7 +388,7 @@ ExternDecl: EXTERN VarDecl
 					}
 
 					$$ = $2;
-					$$->setLoc((Loc*)&(@$));
+					$$->setLoc(@$);
 				}
 			}
 	   ;
@@ -385,7 +404,7 @@ StaticDecl: STATIC VarDecl
 					}
 
 					$$ = $2;
-					$$->setLoc((Loc*)&(@$));
+					$$->setLoc(@$);
 				}
 			}
 		  ;
@@ -401,7 +420,7 @@ VarDecl: Type VarList SEMICOLON
 				
 					$$ = new VarDeclNode($2);
 					$$->valueTy = $1;
-					$$->setLoc((Loc*)&(@$));
+					$$->setLoc(@$);
 					astNodes.push_back($$);
 				}	
 			}
@@ -411,7 +430,7 @@ VarList: VarDef
 	   		{
 				if (!errorFlag) {
 					$$ = new NodeList($1);
-					$$->setLoc((Loc*)&(@$));
+					$$->setLoc(@$);
 					astNodes.push_back($$);
 				}
 			}
@@ -420,7 +439,7 @@ VarList: VarDef
 				if (!errorFlag) {
 					$1->append($3);
 					$$ = $1;
-					$$->setLoc((Loc*)&(@$));
+					$$->setLoc(@$);
 				}
 			}
 	   ;
@@ -433,20 +452,20 @@ VarDef: Var
 					$$ = new ArrayVarDefNode($1.name, NULL);
 					$$->valueTy = $1.vType;
 					$$->valueTy.dim = $$->valueTy.argv->nodes.size();
-					$$->setLoc((Loc*)&(@$));
+					$$->setLoc(@$);
 					astNodes.push_back($$);
 
 				}
 				else if ($1.vType.type == FUNC_TYPE) {
 					$$ = new FuncDeclNode($1.name, $1.vType.argv != NULL);
 					$$->valueTy = $1.vType;
-					$$->setLoc((Loc*)&(@$));
+					$$->setLoc(@$);
 					astNodes.push_back($$);
 				}
 				else {
 					$$ = new IdVarDefNode($1.name, NULL);
 					$$->valueTy = $1.vType;
-					$$->setLoc((Loc*)&(@$));
+					$$->setLoc(@$);
 					astNodes.push_back($$);
 
 				}
@@ -468,7 +487,7 @@ AssignedVar: Var ASIGN Exp
 						$$ = new IdVarDefNode($1.name, (ExpNode*)$3);
 
 					$$->valueTy = $1.vType;
-					$$->setLoc((Loc*)&(@$));
+					$$->setLoc(@$);
 					astNodes.push_back($$);
 				}
 			}
@@ -478,7 +497,7 @@ AssignedVar: Var ASIGN Exp
 					$$ = new ArrayVarDefNode($1.name, $4);
 					$$->valueTy = $1.vType;
 					$$->valueTy.dim = $$->valueTy.argv->nodes.size();
-					$$->setLoc((Loc*)&(@$));
+					$$->setLoc(@$);
 					astNodes.push_back($$);
 				}
 			}
@@ -511,7 +530,7 @@ Var: ID
 	 	{
 			if (!errorFlag) {
 				$$ = $2;
-				ValueTypeS *thisTy = new ValueTypeS;
+				ValueTypeS *thisTy = newValueType();
 				*thisTy = (ValueTypeS){PTR_TYPE, 		// type
 							NO_TYPE, 		// dstType
 							false, 				// isConstant
@@ -532,13 +551,13 @@ Var: ID
 		{
 			if (!errorFlag) {
 				$$ = $1;
-				ValueTypeS *thisTy = new ValueTypeS;
+				ValueTypeS *thisTy = newValueType();
 				*thisTy = (ValueTypeS){ARRAY_TYPE,  		// type
 							NO_TYPE, 		// dstType
 							false, 				// isConstant
 							false, 				// isExtern
 							false, 				// isStatic
-							$2->nodes.size(), 	// dim
+							(int)$2->nodes.size(), // dim
 							NULL, 				// bases
 							(NodeList*)$2, 		// argv   
 							NULL, 				// structName
@@ -553,7 +572,7 @@ Var: ID
 	   	{
 			if (!errorFlag) {
 				$$ = $1;
-				ValueTypeS *thisTy = new ValueTypeS;
+				ValueTypeS *thisTy = newValueType();
 				*thisTy = (ValueTypeS){FUNC_TYPE,  		// type
 							NO_TYPE, 		// dstType
 							false, 				// isConstant
@@ -575,7 +594,7 @@ Var: ID
 		{
 			if (!errorFlag) {
 				$$ = $1;
-				ValueTypeS *thisTy = new ValueTypeS;
+				ValueTypeS *thisTy = newValueType();
 				*thisTy = (ValueTypeS){FUNC_TYPE,  		// type
 							NO_TYPE, 		// dstType
 							false, 				// isConstant
@@ -605,7 +624,7 @@ ArraySuffix: LBRACKET Exp RBRACKET
 		   	{
 				if (!errorFlag) {
 					$$ = new NodeList($2);
-					$$->setLoc((Loc*)&(@$));
+					$$->setLoc(@$);
 					astNodes.push_back($$);
 				}
 			}
@@ -613,7 +632,7 @@ ArraySuffix: LBRACKET Exp RBRACKET
 		   	{
 				if (!errorFlag) {
 					$$ = new NodeList(NULL);
-					$$->setLoc((Loc*)&(@$));
+					$$->setLoc(@$);
 					astNodes.push_back($$);
 				}
 			}
@@ -622,7 +641,7 @@ ArraySuffix: LBRACKET Exp RBRACKET
 				if (!errorFlag) {
 					$1->append($3);
 					$$ = $1;
-					$$->setLoc((Loc*)&(@$));
+					$$->setLoc(@$);
 				}
 			}
 		   ;
@@ -634,8 +653,9 @@ ArgNameList: Type Var
 				IdNode *node = new IdNode($2.name);
 				node->valueTy = $2.vType;
 				setAtomType(&(node->valueTy), $1);
+				astNodes.push_back(node);
 				$$ = new NodeList(node);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -645,9 +665,10 @@ ArgNameList: Type Var
 				IdNode *node = new IdNode($4.name);
 				node->valueTy = $4.vType;
 				setAtomType(&(node->valueTy), $3);
+				astNodes.push_back(node);
 				$1->append(node);
 				$$ = $1;
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 			}
 		}
 	  ;
@@ -664,9 +685,10 @@ FuncDef: Type Var Block
 					FuncDeclNode *decl = new FuncDeclNode($2.name, $2.vType.argv != NULL);
 					decl->valueTy = $2.vType;
 					setAtomType(&(decl->valueTy), $1);
+					astNodes.push_back(decl);
 
 					$$ = new FuncDefNode(decl, (BlockNode*)$3);
-					$$->setLoc((Loc*)&(@$));
+					$$->setLoc(@$);
 					astNodes.push_back($$);
 				}
 			}
@@ -677,7 +699,7 @@ StructDef: STRUCT ID Block SEMICOLON
 		 	{
 				if (!errorFlag) {
 					$$ = new StructDefNode($2, ((BlockNode*)$3)->blockItems);
-					$$->setLoc((Loc*)&(@$));
+					$$->setLoc(@$);
 					astNodes.push_back($$);
 				}
 				else {
@@ -691,23 +713,17 @@ FunCall: Exp LPARENT RPARENT
 	   	{
 			if (!errorFlag) {
 				$$ = new FunCallNode((ExpNode*)$1, NULL);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
-			else {
-				delete $1;
-			}
 		}
 	   | Exp LPARENT ExpList RPARENT
 	   	{
 			if (!errorFlag) {
 				$$ = new FunCallNode((ExpNode*)$1, (NodeList*)$3);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
-			else {
-				delete $1;
-			}
 		}
 	   ;
 
@@ -716,7 +732,7 @@ Block: LBRACE BlockItemList RBRACE
 	 	{
 			if (!errorFlag) {
 				$$ = new BlockNode($2);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -726,7 +742,7 @@ BlockItemList: BlockItem
 			 	{
 					if (!errorFlag) {
 						$$ = new NodeList($1);
-						$$->setLoc((Loc*)&(@$));
+						$$->setLoc(@$);
 						astNodes.push_back($$);
 					}
 				}
@@ -735,7 +751,7 @@ BlockItemList: BlockItem
 					if (!errorFlag) {
 						$1->append($2);
 						$$ = $1;
-						$$->setLoc((Loc*)&(@$));
+						$$->setLoc(@$);
 					}
 				}
 			 ;
@@ -754,21 +770,11 @@ BlockItem: VarDecl
 			}
 		 ;
 
-Stmt: LVal ASIGN Exp SEMICOLON 
+Stmt: SimpleStmt SEMICOLON
 		{
 			if (!errorFlag) {
-				$$ = new AssignStmtNode((ExpNode*)$1, (ExpNode*)$3);
-				$$->setLoc((Loc*)&(@$));
-				astNodes.push_back($$);
-			}
-		}
-
-	| FunCall SEMICOLON
-		{
-			if (!errorFlag) {
-				$$ = new FunCallStmtNode((FunCallNode*)($1));	
-				$$->setLoc((Loc*)&(@$));
-				astNodes.push_back($$);
+				$$ = $1;
+				$$->setLoc(@$);
 			}
 		}
 
@@ -776,7 +782,7 @@ Stmt: LVal ASIGN Exp SEMICOLON
 		{
 			if (!errorFlag) {
 				$$ = new BlockStmtNode((BlockNode*)$1);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -785,7 +791,7 @@ Stmt: LVal ASIGN Exp SEMICOLON
 		{
 			if (!errorFlag) {
 				$$ = new IfStmtNode((CondNode*)$3, (StmtNode*)$5, NULL);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -794,7 +800,7 @@ Stmt: LVal ASIGN Exp SEMICOLON
 		{
 			if (!errorFlag) {
 				$$ = new IfStmtNode((CondNode*)$3, (StmtNode*)$5, (StmtNode*)$7);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -803,7 +809,16 @@ Stmt: LVal ASIGN Exp SEMICOLON
 		{
 			if (!errorFlag) {
 				$$ = new WhileStmtNode((CondNode*)$3, (StmtNode*)$5);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
+				astNodes.push_back($$);
+			}
+		}
+
+	| FOR LPARENT ForInit SEMICOLON ForCond SEMICOLON ForStep RPARENT Stmt
+		{
+			if (!errorFlag) {
+				$$ = new ForStmtNode((StmtNode*)$3, (CondNode*)$5, (StmtNode*)$7, (StmtNode*)$9);
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -812,7 +827,16 @@ Stmt: LVal ASIGN Exp SEMICOLON
 		{
 			if (!errorFlag) {
 				$$ = new ReturnStmtNode((ExpNode*)$2);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
+				astNodes.push_back($$);
+			}
+		}
+
+	| RETURN SEMICOLON
+		{
+			if (!errorFlag) {
+				$$ = new ReturnStmtNode(NULL);
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -821,7 +845,7 @@ Stmt: LVal ASIGN Exp SEMICOLON
 		{
 			if (!errorFlag) {
 				$$ = new BreakStmtNode();
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -830,7 +854,7 @@ Stmt: LVal ASIGN Exp SEMICOLON
 		{
 			if (!errorFlag) {
 				$$ = new ContinueStmtNode();
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -839,17 +863,144 @@ Stmt: LVal ASIGN Exp SEMICOLON
 		{
 			if (!errorFlag) {
 				$$ = new EmptyNode();
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
+				astNodes.push_back($$);
+			}
+		}
+	;
+
+// statements that also make up the head of a for loop
+SimpleStmt: LVal ASIGN Exp
+		{
+			if (!errorFlag) {
+				$$ = new AssignStmtNode((ExpNode*)$1, (ExpNode*)$3);
+				$$->setLoc(@$);
+				astNodes.push_back($$);
+			}
+		}
+
+	| LVal ADD_ASIGN Exp
+		{
+			if (!errorFlag) {
+				$$ = new AssignStmtNode((ExpNode*)$1, (ExpNode*)$3, '+');
+				$$->setLoc(@$);
+				astNodes.push_back($$);
+			}
+		}
+
+	| LVal SUB_ASIGN Exp
+		{
+			if (!errorFlag) {
+				$$ = new AssignStmtNode((ExpNode*)$1, (ExpNode*)$3, '-');
+				$$->setLoc(@$);
+				astNodes.push_back($$);
+			}
+		}
+
+	| LVal MULT_ASIGN Exp
+		{
+			if (!errorFlag) {
+				$$ = new AssignStmtNode((ExpNode*)$1, (ExpNode*)$3, '*');
+				$$->setLoc(@$);
+				astNodes.push_back($$);
+			}
+		}
+
+	| LVal DIV_ASIGN Exp
+		{
+			if (!errorFlag) {
+				$$ = new AssignStmtNode((ExpNode*)$1, (ExpNode*)$3, '/');
+				$$->setLoc(@$);
+				astNodes.push_back($$);
+			}
+		}
+
+	| LVal MOD_ASIGN Exp
+		{
+			if (!errorFlag) {
+				$$ = new AssignStmtNode((ExpNode*)$1, (ExpNode*)$3, '%');
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
+
+	| LVal INC
+		{
+			if (!errorFlag) {
+				NumNode *one = new NumNode(1);
+				one->setLoc(@2);
+				astNodes.push_back(one);
+
+				$$ = new AssignStmtNode((ExpNode*)$1, one, '+');
+				$$->setLoc(@$);
+				astNodes.push_back($$);
+			}
+		}
+
+	| LVal DEC
+		{
+			if (!errorFlag) {
+				NumNode *one = new NumNode(1);
+				one->setLoc(@2);
+				astNodes.push_back(one);
+
+				$$ = new AssignStmtNode((ExpNode*)$1, one, '-');
+				$$->setLoc(@$);
+				astNodes.push_back($$);
+			}
+		}
+
+	| FunCall
+		{
+			if (!errorFlag) {
+				$$ = new FunCallStmtNode((FunCallNode*)($1));	
+				$$->setLoc(@$);
+				astNodes.push_back($$);
+			}
+		}
+	;
+
+ForInit: %empty
+		{
+			$$ = NULL;
+		}
+	| SimpleStmt
+		{
+			if (!errorFlag) {
+				$$ = $1;
+			}
+		}
+	;
+
+ForCond: %empty
+		{
+			$$ = NULL;
+		}
+	| Cond
+		{
+			if (!errorFlag) {
+				$$ = $1;
+			}
+		}
+	;
+
+ForStep: %empty
+		{
+			$$ = NULL;
+		}
+	| SimpleStmt
+		{
+			if (!errorFlag) {
+				$$ = $1;
+			}
+		}
 	;
 
 Cond: LPARENT Cond RPARENT
 		{
 			if (!errorFlag) {
 				$$ = $2;
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 			}
 		}
 
@@ -857,7 +1008,7 @@ Cond: LPARENT Cond RPARENT
 		{
 			if (!errorFlag) {
 				$$ = new CondNode(OR_OP, $1, $3);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -866,7 +1017,7 @@ Cond: LPARENT Cond RPARENT
 		{
 			if (!errorFlag) {
 				$$ = new CondNode(AND_OP, $1, $3);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -875,7 +1026,7 @@ Cond: LPARENT Cond RPARENT
 		{
 			if (!errorFlag) {
 				$$ = new CondNode(NOT_OP, NULL, $2);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -884,7 +1035,7 @@ Cond: LPARENT Cond RPARENT
 		{
 			if (!errorFlag) {
 				$$ = new CondNode(LT_OP, $1, $3);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -893,7 +1044,7 @@ Cond: LPARENT Cond RPARENT
 		{
 			if (!errorFlag) {
 				$$ = new CondNode(GT_OP, $1, $3);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -902,7 +1053,7 @@ Cond: LPARENT Cond RPARENT
 		{
 			if (!errorFlag) {
 				$$ = new CondNode(LTE_OP, $1, $3);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -911,7 +1062,7 @@ Cond: LPARENT Cond RPARENT
 		{
 			if (!errorFlag) {
 				$$ = new CondNode(GTE_OP, $1, $3);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -920,7 +1071,7 @@ Cond: LPARENT Cond RPARENT
 		{
 			if (!errorFlag) {
 				$$ = new CondNode(EQ_OP, $1, $3);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -929,7 +1080,7 @@ Cond: LPARENT Cond RPARENT
 		{
 			if (!errorFlag) {
 				$$ = new CondNode(NEQ_OP, $1, $3);
-				$$->setLoc((Loc*)&(@$));
+				$$->setLoc(@$);
 				astNodes.push_back($$);
 			}
 		}
@@ -945,12 +1096,16 @@ int yyerror(const char *msg)
 }
 
 
+// release everything owned by the AST (see node.h)
 void clearAstNodes()
 {
 	while (!astNodes.empty()) {
 	 	delete astNodes.front();
 		astNodes.pop_front();
 	}
+	clearTypePool();
+	resetNodeIds();
+	root = NULL;
 }
 
 static void insertType(ValueTypeS *pType, ValueTypeS *thisTy)
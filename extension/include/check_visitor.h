@@ -2,62 +2,121 @@
 #define _CHECK_VISITOR_H_
 
 #include "visitor.h"
+#include "type_table.h"
+#include "symbol_table.h"
+#include "msgfactory.h"
+#include "dep_graph.h"
 #include <map>
+#include <vector>
 
 
-class CheckVisitor : public Visitor {
+// Layout of a struct, worked out once when its definition is checked.
+// Field indices are what codegen uses in GEPs, byte offsets and sizes follow
+// the usual natural alignment of an LP64 target.
+struct FieldLayout {
+	std::string name;
+	ValueTypeS vType;
+	int index;
+	int offset;
+	int size;
+};
+
+struct StructLayout {
+	std::vector<FieldLayout> fields;
+	std::map<std::string, int> indexOf;
+	int size;
+	int align;
+	SrcLoc loc;		// where the struct is defined
+};
+
+
+class CheckVisitor : public Visitor<CheckVisitor> {
 public:
-	CheckVisitor();
+	CheckVisitor(TypeTable &types, MsgFactory &msgs);
+	// a worker checking function bodies on behalf of parent, see
+	// visitCompUnitNode; its messages go to msgs
+	CheckVisitor(const CheckVisitor &parent, MsgFactory &msgs);
 	~CheckVisitor();
 
-	virtual void visitNodeList(NodeList *node);
-	virtual void visitNumNode(NumNode *node);
-	virtual void visitFNumNode(FNumNode *node);
-	virtual void visitCharNode(CharNode *node);
-	virtual void visitBinaryExpNode(BinaryExpNode *node);
-	virtual void visitUnaryExpNode(UnaryExpNode *node);
-	virtual void visitIdNode(IdNode *node);
-	virtual void visitArrayItemNode(ArrayItemNode *node);
-	virtual void visitStructItemNode(StructItemNode *node);
-	virtual void visitFunCallNode(FunCallNode *node);
-	virtual void visitIdVarDefNode(IdVarDefNode *node);
-	virtual void visitArrayVarDefNode(ArrayVarDefNode *node);
-	virtual void visitEmptyNode(EmptyNode *node);
-	virtual void visitBlockNode(BlockNode *node);
-	virtual void visitVarDeclNode(VarDeclNode *node);
-	virtual void visitAssignStmtNode(AssignStmtNode *node);
-	virtual void visitFunCallStmtNode(FunCallStmtNode *node);
-	virtual void visitBlockStmtNode(BlockStmtNode *node);
-	virtual void visitCondNode(CondNode *node);
-	virtual void visitIfStmtNode(IfStmtNode *node);
-	virtual void visitWhileStmtNdoe(WhileStmtNode *node);
-	virtual void visitReturnStmtNdoe(ReturnStmtNode *node);
-	virtual void visitBreakStmtNode(BreakStmtNode *node);
-	virtual void visitContinueStmtNode(ContinueStmtNode *node);
-	virtual void visitFuncDeclNode(FuncDeclNode *node);
-	virtual void visitFuncDefNode(FuncDefNode *node);
-	virtual void visitStructDefNode(StructDefNode *node);
-	virtual void visitCompUnitNode(CompUnitNode *node);
-
-	virtual void enterBlockNode(BlockNode *node);
-	virtual void enterIfStmtNode(IfStmtNode *node);
-	virtual void enterWhileStmtNode(WhileStmtNode *node);
-	virtual void enterFuncDefNode(FuncDefNode *node);
-	virtual void enterStructDefNode(StructDefNode *node);
+	void visitNodeList(NodeList *node);
+	void visitNumNode(NumNode *node);
+	void visitFNumNode(FNumNode *node);
+	void visitCharNode(CharNode *node);
+	void visitBinaryExpNode(BinaryExpNode *node);
+	void visitUnaryExpNode(UnaryExpNode *node);
+	void visitIdNode(IdNode *node);
+	void visitArrayItemNode(ArrayItemNode *node);
+	void visitStructItemNode(StructItemNode *node);
+	void visitFunCallNode(FunCallNode *node);
+	void visitIdVarDefNode(IdVarDefNode *node);
+	void visitArrayVarDefNode(ArrayVarDefNode *node);
+	void visitEmptyNode(EmptyNode *node);
+	void visitBlockNode(BlockNode *node);
+	void visitVarDeclNode(VarDeclNode *node);
+	void visitAssignStmtNode(AssignStmtNode *node);
+	void visitFunCallStmtNode(FunCallStmtNode *node);
+	void visitBlockStmtNode(BlockStmtNode *node);
+	void visitCondNode(CondNode *node);
+	void visitIfStmtNode(IfStmtNode *node);
+	void visitWhileStmtNdoe(WhileStmtNode *node);
+	void visitForStmtNode(ForStmtNode *node);
+	void visitReturnStmtNdoe(ReturnStmtNode *node);
+	void visitBreakStmtNode(BreakStmtNode *node);
+	void visitContinueStmtNode(ContinueStmtNode *node);
+	void visitFuncDeclNode(FuncDeclNode *node);
+	void visitFuncDefNode(FuncDefNode *node);
+	void visitStructDefNode(StructDefNode *node);
+	void visitCompUnitNode(CompUnitNode *node);
 
 	void setDebug();
+	bool failed() const;
+
+	// record what every item uses in deps, and leave out the bodies it says
+	// can be reused
+	void setDepGraph(DepGraph *deps);
+
+	// used by the worker threads of visitCompUnitNode, returns the first
+	// body that ends in an error, to if none does
+	int checkFuncBodies(const CheckVisitor &parent, int from, int to);
 
 private:
+	TypeTable &types;
+	MsgFactory &msgs;
+	bool hasError;
+
+	SymbolTable symTable;
+	std::map<std::string, StructLayout> structTable;
+
+	// Functions whose bodies are checked after all global declarations,
+	// with the symbol table height, error state and message counts right
+	// after their own declaration, so a body still only sees what is
+	// declared above it, and the messages of the declarations below it can
+	// be dropped if it fails.
+	struct PendingBody {
+		FuncDefNode *func;
+		int item;
+		int height;
+		bool hasError;
+		size_t nErrors, nWarnings;
+	};
+	std::vector<PendingBody> pending;
+
+	// structs defined at or after this offset are not visible yet
+	SrcLoc visibleBefore;
 
-	std::map<std::string, ValueTypeS> *symTableStack[32];
-	std::map<std::string, ValueTypeS> globalSymTabble;
-	int stackPtr;
-	std::map<std::string, std::map<std::string, ValueTypeS>* > structTable;
+	// the item of deps being checked, -1 if none
+	DepGraph *deps;
+	int curItem;
+	bool inBody;
+	void noteUse(const std::string &name);
 
 	bool debug;
 	bool isGlobal;
-	ValueTypeS lookUpSym(std::string name);
+	int loopDepth;		// loops around the statement being checked
+	const ValueTypeS *retType;	// of the function whose body is checked
+	void checkFuncBody(FuncDefNode *node);
 	void handleArrayType(ValueTypeS *vType);
+	void getSizeAlign(const ValueTypeS &vType, int *size, int *align);
 };
 
 
@@ -6,70 +6,154 @@
 #include <vector>
 #include "visitor.h"
 #include "node.h"
+#include "type_table.h"
+#include "dep_graph.h"
+#include "effect_visitor.h"
 
 namespace llvm {
+class Type;
 class Value;
 class AllocaInst;
 class GlobalVariable;
 class BasicBlock;
+class BranchInst;
+class LoadInst;
+class MDNode;
+class StructType;
+class Function;
+class Module;
 }
 
-class CodegenVisitor : public Visitor {
+class CodegenVisitor : public Visitor<CodegenVisitor, llvm::Value *> {
 public:
-	CodegenVisitor(std::string output_filename);
+	CodegenVisitor(std::string output_filename, const TypeTable &types);
 	~CodegenVisitor();
 
 	void dump();
 
-	virtual void visitNodeList(NodeList *node);
-	virtual void visitNumNode(NumNode *node);
-	virtual void visitFNumNode(FNumNode *node);
-	virtual void visitCharNode(CharNode *node);
-	virtual void visitBinaryExpNode(BinaryExpNode *node);
-	virtual void visitUnaryExpNode(UnaryExpNode *node);
-	virtual void visitIdNode(IdNode *node);
-	virtual void visitArrayItemNode(ArrayItemNode *node);
-	virtual void visitStructItemNode(StructItemNode *node);
-	virtual void visitFunCallNode(FunCallNode *node);
-	virtual void visitIdVarDefNode(IdVarDefNode *node);
-	virtual void visitArrayVarDefNode(ArrayVarDefNode *node);
-	virtual void visitEmptyNode(EmptyNode *node);
-	virtual void visitBlockNode(BlockNode *node);
-	virtual void visitVarDeclNode(VarDeclNode *node);
-	virtual void visitAssignStmtNode(AssignStmtNode *node);
-	virtual void visitFunCallStmtNode(FunCallStmtNode *node);
-	virtual void visitBlockStmtNode(BlockStmtNode *node);
-	virtual void visitCondNode(CondNode *node);
-	virtual void visitIfStmtNode(IfStmtNode *node);
-	virtual void visitWhileStmtNdoe(WhileStmtNode *node);
-	virtual void visitReturnStmtNdoe(ReturnStmtNode *node);
-	virtual void visitBreakStmtNode(BreakStmtNode *node);
-	virtual void visitContinueStmtNode(ContinueStmtNode *node);
-	virtual void visitFuncDeclNode(FuncDeclNode *node);
-	virtual void visitFuncDefNode(FuncDefNode *node);
-	virtual void visitStructDefNode(StructDefNode *node);
-	virtual void visitCompUnitNode(CompUnitNode *node);
-
-	virtual void enterBlockNode(BlockNode *node);
-	virtual void enterIfStmtNode(IfStmtNode *node);
-	virtual void enterWhileStmtNode(WhileStmtNode *node);
-	virtual void enterFuncDefNode(FuncDefNode *node);
-	virtual void enterStructDefNode(StructDefNode *node);
+	// take the bodies deps says can be reused from prev, the module of the
+	// previous compilation, instead of lowering them again
+	void reuseBodies(const DepGraph *deps, llvm::Module *prev);
+
+	// mark functions and their pointer arguments with what effects found
+	void setEffects(const EffectVisitor *effects);
+
+	llvm::Value *visitNodeList(NodeList *node);
+	llvm::Value *visitNumNode(NumNode *node);
+	llvm::Value *visitFNumNode(FNumNode *node);
+	llvm::Value *visitCharNode(CharNode *node);
+	llvm::Value *visitBinaryExpNode(BinaryExpNode *node);
+	llvm::Value *visitUnaryExpNode(UnaryExpNode *node);
+	llvm::Value *visitIdNode(IdNode *node);
+	llvm::Value *visitArrayItemNode(ArrayItemNode *node);
+	llvm::Value *visitStructItemNode(StructItemNode *node);
+	llvm::Value *visitFunCallNode(FunCallNode *node);
+	llvm::Value *visitIdVarDefNode(IdVarDefNode *node);
+	llvm::Value *visitArrayVarDefNode(ArrayVarDefNode *node);
+	llvm::Value *visitEmptyNode(EmptyNode *node);
+	llvm::Value *visitBlockNode(BlockNode *node);
+	llvm::Value *visitVarDeclNode(VarDeclNode *node);
+	llvm::Value *visitAssignStmtNode(AssignStmtNode *node);
+	llvm::Value *visitFunCallStmtNode(FunCallStmtNode *node);
+	llvm::Value *visitBlockStmtNode(BlockStmtNode *node);
+	llvm::Value *visitCondNode(CondNode *node);
+	llvm::Value *visitIfStmtNode(IfStmtNode *node);
+	llvm::Value *visitWhileStmtNdoe(WhileStmtNode *node);
+	llvm::Value *visitForStmtNode(ForStmtNode *node);
+	llvm::Value *visitReturnStmtNdoe(ReturnStmtNode *node);
+	llvm::Value *visitBreakStmtNode(BreakStmtNode *node);
+	llvm::Value *visitContinueStmtNode(ContinueStmtNode *node);
+	llvm::Value *visitFuncDeclNode(FuncDeclNode *node);
+	llvm::Value *visitFuncDefNode(FuncDefNode *node);
+	llvm::Value *visitStructDefNode(StructDefNode *node);
+	llvm::Value *visitCompUnitNode(CompUnitNode *node);
 
 private:
-	std::map<std::string, llvm::AllocaInst *> *ConstLocalTableStack[32];
-	std::map<std::string, llvm::AllocaInst *> *LocalTableStack[32];
-	std::map<std::string, llvm::GlobalVariable *> GloblalVariables;
-	int StackPtr;
+	const TypeTable &types;
+
+	// the address (or Function) of every declaration, indexed by Node::id
+	std::vector<llvm::Value *> values;
+
+	// where continue and break go in each enclosing loop, innermost last
+	struct LoopTargets {
+		llvm::BasicBlock *continueBB;
+		llvm::BasicBlock *breakBB;
+	};
+	std::vector<LoopTargets> loops;
+	unsigned loopCount;	// loops emitted so far, numbers their llvm.loop ids
+	void jumpTo(llvm::BasicBlock *target);
+	void emitLoop(CondNode *cond, StmtNode *body, StmtNode *step);
+	llvm::BranchInst *emitCondBr(CondNode *cond, llvm::BasicBlock *trueBB, llvm::BasicBlock *falseBB);
+	void openDeadBlock();
+
+	const DepGraph *deps;
+	llvm::Module *prevModule;
+	std::vector<llvm::Function *> reused;	// declared here, body still in prevModule
+	const EffectVisitor *effects;
+	void cloneReusedBodies();
+
+	// TBAA type nodes and access tags, built on first use.  A scalar loaded
+	// or stored on its own gets a tag for its type, a struct member one for
+	// the struct and its offset; aggregates get none and may alias anything.
+	// createLoad and createStore use the scalar tag unless given another.
+	std::map<llvm::Type *, llvm::MDNode *> tbaaTypes;
+	std::map<llvm::Type *, llvm::MDNode *> tbaaTags;
+	std::map<std::pair<llvm::Type *, unsigned>, llvm::MDNode *> tbaaFieldTags;
+	llvm::MDNode *getTBAATypeNode(llvm::Type *type);
+	llvm::MDNode *getTBAATag(llvm::Type *type);
+	llvm::MDNode *getTBAAFieldTag(llvm::StructType *type, unsigned field);
+	llvm::LoadInst *createLoad(llvm::Value *ptr, const std::string &name = "", llvm::MDNode *tag = 0);
+	void createStore(llvm::Value *v, llvm::Value *ptr, llvm::MDNode *tag = 0);
+
+	// lowered types by their structure: equal types have equal keys however
+	// they were declared
+	struct TypeKey {
+		ValueType type;
+		std::vector<int> bounds;	// of an array
+		std::string structName;
+		std::vector<TypeKey> parts;	// the atom, then the argument types
+
+		TypeKey(const ValueTypeS &vType, const TypeTable &types);
+		bool operator<(const TypeKey &other) const;
+	};
+	std::map<TypeKey, llvm::Type *> typeCache;
+	llvm::Type *lowerType(const ValueTypeS &vType);
 
-	std::vector<llvm::Value *> pending;
-	llvm::BasicBlock *funcEndBB;
-	llvm::AllocaInst *returnValue;
+	// How values cross a call on x86-64 (System V): scalars, and the address
+	// an array decays to, as they are; a struct of at most 16 bytes in one
+	// register per eightbyte (COERCED), while there are enough left; any
+	// other struct in memory (INDIRECT: byval, or sret for the result).
+	struct ABIArg {
+		enum Kind { DIRECT, INDIRECT, COERCED };
+		Kind kind;
+		llvm::Type *parts[2];	// the registers of a COERCED struct
+		int nParts;
+	};
+	struct ABIInfo {
+		ABIArg ret;
+		std::vector<ABIArg> args;
+	};
+	std::map<TypeKey, ABIInfo> abiCache;
+	ABIInfo curABI;		// of the function being generated
+	const ABIInfo &classifyCall(const ValueTypeS &funcTy);
+	bool classifyStruct(llvm::Type *type, ABIArg *abi, int *nInt, int *nSSE);
+	llvm::Type *getCoercedType(const ABIArg &abi);
+	llvm::Value *createCoerced(const ABIArg &abi);
+	llvm::Value *coerceFrom(const ABIArg &abi, llvm::Value *structPtr);
+	void coerceTo(llvm::Value *coerced, llvm::Value *structPtr);
+	llvm::Value *getCoercedPart(const ABIArg &abi, llvm::Value *coerced, int part);
 
-	std::map<std::string, std::map<std::string, int>* > structOffsetTable;
+	llvm::Value *lookUp(IdNode *node);
+	llvm::Type *getLLVMVarType(const ValueTypeS &vType);
+	llvm::Value *getConstant(const ValueTypeS &vType);
+	std::vector<llvm::Value *> getValuesFromList(NodeList *list);
+	std::vector<llvm::Type *> getMemberTypes(StructDefNode *node);
 
-	llvm::Value *lookUp(std::string nameStr);
-	std::vector<llvm::Value *> getValuesFromStack(int size);
+	// the struct types of this module by name, see visitStructDefNode
+	std::map<std::string, llvm::StructType *> structTypes;
+	llvm::Value *getStructItemPtr(StructItemNode *node, llvm::MDNode **tag = 0);
+	llvm::Value *getArrayItemPtr(ArrayItemNode *node);
+	llvm::Value *getLValPtr(ExpNode *lval, llvm::MDNode **tag = 0);
 };
 
 
@@ -0,0 +1,72 @@
+#ifndef _DEP_GRAPH_H_
+#define _DEP_GRAPH_H_
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include "node.h"
+
+
+// Dependencies between the top-level items of a file, kept from one
+// compilation to the next by the incremental mode (-i).
+//
+// An item is a global declaration, a struct or a function.  It is known by
+// the first name it declares (structs as "struct.<name>"), so the graphs of
+// two compilations of the same file can be matched up.  For every item we
+// keep a hash of its declaration (for a function the text up to its body,
+// otherwise the whole item), a hash of its body, and the names of the global
+// items the checker saw its declaration and its body use.
+//
+// An item changes when its declaration text does, or when an item its
+// declaration uses changes, so a new constant value or struct layout reaches
+// every user.  A function body can be reused, i.e. neither checked nor
+// lowered again, if the function did not change, its body text is the same
+// and none of the items the body uses changed.
+struct DepItem {
+	std::string name;
+	std::vector<std::string> names;		// every name the item declares
+	Node *node;
+	bool hasBody;
+	unsigned long declHash;
+	unsigned long bodyHash;
+	std::set<std::string> uses;
+	std::set<std::string> bodyUses;
+	bool changed;
+	bool reuse;
+};
+
+class DepGraph {
+public:
+	// one item per element of root, hashed from the source text
+	void build(CompUnitNode *root, const std::string &source);
+
+	int size() const;
+	DepItem &item(int i);
+	const DepItem &item(int i) const;
+	int find(const std::string &name) const;		// -1 if not declared
+	int itemOf(const Node *node) const;				// -1 if not an item
+
+	void use(int i, const std::string &name, bool inBody);
+
+	// decide which bodies can be kept from the compilation prev was made for
+	void compare(const DepGraph &prev);
+	bool reusable(const Node *node) const;
+	void dontReuse(int i);
+
+	bool load(const char *fileName);
+	bool save(const char *fileName) const;
+
+private:
+	std::vector<DepItem> items;
+	std::map<std::string, int> byName;
+	std::map<const Node *, int> byNode;
+
+	void addItem(const DepItem &item);
+	bool usesChanged(int i, const std::set<std::string> &uses) const;
+	static unsigned long hashText(const std::string &source, SrcLoc from, SrcLoc to);
+};
+
+
+
+#endif /* _DEP_GRAPH_H_ */
@@ -2,57 +2,51 @@
 #define _DUMPDOT_VISITOR_H_
 
 #include <cstdio>
-#include <vector>
+#include <list>
 #include "visitor.h"
 #include "node.h"
 
 class DumpDOT;
 
-class DumpDotVisitor : public Visitor {
+class DumpDotVisitor : public Visitor<DumpDotVisitor, int> {
 public:
 	DumpDotVisitor(FILE *file);
 	~DumpDotVisitor();
 
-	virtual void visitNodeList(NodeList *node);
-	virtual void visitNumNode(NumNode *node);
-	virtual void visitFNumNode(FNumNode *node);
-	virtual void visitCharNode(CharNode *node);
-	virtual void visitBinaryExpNode(BinaryExpNode *node);
-	virtual void visitUnaryExpNode(UnaryExpNode *node);
-	virtual void visitIdNode(IdNode *node);
-	virtual void visitArrayItemNode(ArrayItemNode *node);
-	virtual void visitStructItemNode(StructItemNode *node);
-	virtual void visitFunCallNode(FunCallNode *node);
-	virtual void visitIdVarDefNode(IdVarDefNode *node);
-	virtual void visitArrayVarDefNode(ArrayVarDefNode *node);
-	virtual void visitEmptyNode(EmptyNode *node);
-	virtual void visitBlockNode(BlockNode *node);
-	virtual void visitVarDeclNode(VarDeclNode *node);
-	virtual void visitAssignStmtNode(AssignStmtNode *node);
-	virtual void visitFunCallStmtNode(FunCallStmtNode *node);
-	virtual void visitBlockStmtNode(BlockStmtNode *node);
-	virtual void visitCondNode(CondNode *node);
-	virtual void visitIfStmtNode(IfStmtNode *node);
-	virtual void visitWhileStmtNdoe(WhileStmtNode *node);
-	virtual void visitReturnStmtNdoe(ReturnStmtNode *node);
-	virtual void visitBreakStmtNode(BreakStmtNode *node);
-	virtual void visitContinueStmtNode(ContinueStmtNode *node);
-	virtual void visitFuncDeclNode(FuncDeclNode *node);
-	virtual void visitFuncDefNode(FuncDefNode *node);
-	virtual void visitStructDefNode(StructDefNode *node);
-	virtual void visitCompUnitNode(CompUnitNode *node);
-
-	virtual void enterBlockNode(BlockNode *node);
-	virtual void enterIfStmtNode(IfStmtNode *node);
-	virtual void enterWhileStmtNode(WhileStmtNode *node);
-	virtual void enterFuncDefNode(FuncDefNode *node);
-	virtual void enterStructDefNode(StructDefNode *node);
+	int visitNodeList(NodeList *node);
+	int visitNumNode(NumNode *node);
+	int visitFNumNode(FNumNode *node);
+	int visitCharNode(CharNode *node);
+	int visitBinaryExpNode(BinaryExpNode *node);
+	int visitUnaryExpNode(UnaryExpNode *node);
+	int visitIdNode(IdNode *node);
+	int visitArrayItemNode(ArrayItemNode *node);
+	int visitStructItemNode(StructItemNode *node);
+	int visitFunCallNode(FunCallNode *node);
+	int visitIdVarDefNode(IdVarDefNode *node);
+	int visitArrayVarDefNode(ArrayVarDefNode *node);
+	int visitEmptyNode(EmptyNode *node);
+	int visitBlockNode(BlockNode *node);
+	int visitVarDeclNode(VarDeclNode *node);
+	int visitAssignStmtNode(AssignStmtNode *node);
+	int visitFunCallStmtNode(FunCallStmtNode *node);
+	int visitBlockStmtNode(BlockStmtNode *node);
+	int visitCondNode(CondNode *node);
+	int visitIfStmtNode(IfStmtNode *node);
+	int visitWhileStmtNdoe(WhileStmtNode *node);
+	int visitForStmtNode(ForStmtNode *node);
+	int visitReturnStmtNdoe(ReturnStmtNode *node);
+	int visitBreakStmtNode(BreakStmtNode *node);
+	int visitContinueStmtNode(ContinueStmtNode *node);
+	int visitFuncDeclNode(FuncDeclNode *node);
+	int visitFuncDefNode(FuncDefNode *node);
+	int visitStructDefNode(StructDefNode *node);
+	int visitCompUnitNode(CompUnitNode *node);
 
 private:
 	DumpDOT *dumper;
-	std::vector<int> pending;
 
-	void dumpList(int length, int nRoot, int pos);
+	void dumpList(std::list<Node *> &nodes, int nRoot, int pos);
 };
 
 
@@ -0,0 +1,121 @@
+#ifndef _EFFECT_VISITOR_H_
+#define _EFFECT_VISITOR_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include "visitor.h"
+#include "type_table.h"
+#include "dep_graph.h"
+
+
+// What a function does to memory its caller can see: nothing, reads only, or
+// (also) writes.  Locals do not count, globals and whatever is reached
+// through a pointer do.
+enum MemEffect {
+	NO_MEM,
+	READ_MEM,
+	WRITE_MEM
+};
+
+// Side-effect analysis over the checked AST, run between the checker and
+// codegen.
+//
+// Every function body is walked once to find what it reads and writes, which
+// functions it calls by name and how it uses its pointer arguments (arrays
+// and structs are passed as pointers too).  The effects of the callees are
+// then merged in over the call graph until nothing changes.  Calls through a
+// function pointer, and calls to functions without a body here (the runtime),
+// may do anything.
+//
+// An argument is not captured if it is only ever dereferenced, i.e. used as
+// the base of '*', '[]', '.' or '->'; it is read-only if it is not captured
+// and nothing is stored through it.
+//
+// Along the way every reference from a function body or a global initializer
+// to a global declaration is recorded, calls and taken addresses alike.  A
+// file that defines main is a program, and only what main reaches is live;
+// any other file is a library, where every function and non-static global is
+// reached from outside.  Codegen leaves out what is not live.  Uses folded
+// away by the checker do not count.
+class EffectVisitor : public Visitor<EffectVisitor> {
+public:
+	EffectVisitor(const TypeTable &types);
+	~EffectVisitor();
+
+	// bodies deps says are reused were not checked, they may do anything
+	void setDepGraph(const DepGraph *deps);
+
+	MemEffect memEffect(const FuncDeclNode *func) const;
+	bool argNoCapture(const Node *arg) const;
+	bool argReadOnly(const Node *arg) const;
+	bool isLive(const Node *decl) const;	// decl is a global or a function
+
+	void visitNodeList(NodeList *node);
+	void visitNumNode(NumNode *node);
+	void visitFNumNode(FNumNode *node);
+	void visitCharNode(CharNode *node);
+	void visitBinaryExpNode(BinaryExpNode *node);
+	void visitUnaryExpNode(UnaryExpNode *node);
+	void visitIdNode(IdNode *node);
+	void visitArrayItemNode(ArrayItemNode *node);
+	void visitStructItemNode(StructItemNode *node);
+	void visitFunCallNode(FunCallNode *node);
+	void visitIdVarDefNode(IdVarDefNode *node);
+	void visitArrayVarDefNode(ArrayVarDefNode *node);
+	void visitEmptyNode(EmptyNode *node);
+	void visitBlockNode(BlockNode *node);
+	void visitVarDeclNode(VarDeclNode *node);
+	void visitAssignStmtNode(AssignStmtNode *node);
+	void visitFunCallStmtNode(FunCallStmtNode *node);
+	void visitBlockStmtNode(BlockStmtNode *node);
+	void visitCondNode(CondNode *node);
+	void visitIfStmtNode(IfStmtNode *node);
+	void visitWhileStmtNdoe(WhileStmtNode *node);
+	void visitForStmtNode(ForStmtNode *node);
+	void visitReturnStmtNdoe(ReturnStmtNode *node);
+	void visitBreakStmtNode(BreakStmtNode *node);
+	void visitContinueStmtNode(ContinueStmtNode *node);
+	void visitFuncDeclNode(FuncDeclNode *node);
+	void visitFuncDefNode(FuncDefNode *node);
+	void visitStructDefNode(StructDefNode *node);
+	void visitCompUnitNode(CompUnitNode *node);
+
+private:
+	enum {
+		ARG_CAPTURED = 1,
+		ARG_WRITTEN = 2
+	};
+
+	struct FuncEffects {
+		MemEffect mem;
+		std::set<const FuncDeclNode *> callees;
+	};
+
+	const TypeTable &types;
+	const DepGraph *deps;
+
+	std::set<const Node *> globals;		// declarations of global variables
+	std::map<const FuncDeclNode *, FuncEffects> funcs;
+	std::map<const Node *, int> args;	// pointer arguments of analyzed functions
+	FuncEffects *cur;
+
+	// top-level declarations by name, what each of them refers to, and what
+	// is reached from the roots
+	std::map<std::string, const Node *> tops;
+	std::map<const Node *, std::set<const Node *> > refs;
+	std::set<const Node *> live;
+	const Node *owner;
+
+	void note(MemEffect mem);
+	void refer(const Node *decl);
+	void markLive(const Node *decl);
+	void access(Node *loc, bool write);
+	void deref(Node *ptr, bool write);
+	void addressOf(Node *loc);
+	bool isPointerArg(const Node *decl) const;
+};
+
+
+
+#endif /* _EFFECT_VISITOR_H_ */
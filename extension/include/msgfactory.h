@@ -4,7 +4,9 @@
 #include <string>
 #include <map>
 #include <list>
+#include <vector>
 #include "util.h"
+#include "node.h"
 
 using namespace std;
 
@@ -13,6 +15,7 @@ enum MsgType {
 	w_miss_int,
 	
 	w_type_cast,
+	w_unreachable_code,
 
 	// errors
 	e_rparent,
@@ -33,9 +36,15 @@ enum MsgType {
 	e_function_arg_cannot_be_functon,
 	e_not_a_struct,
 	e_no_such_struct,
+	e_no_such_member,
 	e_array_index_not_int,
 	e_does_not_have_address,
-	e_not_array_type
+	e_not_array_type,
+	e_jump_outside_loop,
+	e_return_without_value,
+	e_return_value_in_void,
+	e_excess_initializers,
+	e_redefinition_of_struct
 };
 
 // base class of compiling message
@@ -43,8 +52,8 @@ class Message {
 public:
 	friend class MsgFactory;
 
-	Message(int type, int line, int column, const string fileName) 
-		: type(type), line(line), column(column), fileName(fileName) {} 
+	Message(int type, SrcLoc loc, const string fileName) 
+		: type(type), loc(loc), fileName(fileName) {} 
 	virtual ~Message(){};
 
 	// print this message to stdout in proper format 
@@ -52,8 +61,7 @@ public:
 
 protected:
 	int type; 		// type of message, defined in MsgType
-	int line; 		// line number
-	int column; 	// column number
+	SrcLoc loc; 	// byte offset in the source file
 	string fileName;
 };
 
@@ -62,8 +70,8 @@ class Error : public Message {
 public:
 	friend class MsgFactory;
 
-	Error(int type, int line, int column, const string fileName) 
-		: Message(type, line, column, fileName) {} 
+	Error(int type, SrcLoc loc, const string fileName) 
+		: Message(type, loc, fileName) {} 
 	virtual ~Error(){};
 
 	void show();
@@ -74,8 +82,8 @@ class Warning : public Message {
 public:
 	friend class MsgFactory;
 
-	Warning(int type, int line, int column, const string fileName) 
-		: Message(type, line, column, fileName) {} 
+	Warning(int type, SrcLoc loc, const string fileName) 
+		: Message(type, loc, fileName) {} 
 	virtual ~Warning(){};
 
 	void show();
@@ -89,8 +97,21 @@ public:
 
 	void initial(const char *fileName);
 
-	Error newError(int type, int line, int column);
-	Warning newWarning(int type, int line, int column);
+	Error newError(int type, SrcLoc loc);
+	Warning newWarning(int type, SrcLoc loc);
+
+	// move the messages collected by another factory into this one, keeping
+	// them ordered by location
+	void merge(MsgFactory &other);
+
+	// how many messages there are, and forget the ones added after there
+	// were only that many
+	size_t errorCount() const;
+	size_t warningCount() const;
+	void truncate(size_t nErrors, size_t nWarnings);
+
+	// decode a byte offset into 1-based line and column numbers
+	void getLineColumn(SrcLoc loc, int *line, int *column);
 
 	void showMsg(Message *msg);
 	void summary();
@@ -100,7 +121,10 @@ private:
 	list<Error> errors;
 	list<Warning> warnings;
 	FILE *source;
-	long lineOffset[65536];
+	vector<long> lineOffset;	// start offset of every line, built on first use
+
+	void buildLineTable();
+	static bool earlier(const Message &a, const Message &b);
 };
 
 #endif
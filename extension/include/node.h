@@ -5,13 +5,14 @@
 #include <list>
 
 class NodeList;
-class Visitor;
 
 
 using namespace std;
 
 
 typedef enum {
+	NODE_LIST_AST,
+
 	// exp types
 	NUM_AST,
 	FNUM_AST,
@@ -33,15 +34,20 @@ typedef enum {
 
 	STRUCT_DEF_AST,
 
+	EMPTY_STMT_AST,
 	ASSIGN_STMT_AST,
 	FUNCALL_STMT_AST,
 	BLOCK_STMT_AST,
 	IF_STMT_AST,
 	WHILE_STMT_AST,
+	FOR_STMT_AST,
 	RETURN_STMT_AST,
+	BREAK_STMT_AST,
+	CONTINUE_STMT_AST,
 
 	FUNC_DECL_AST,
 	FUNC_DEF_AST,
+	COMP_UNIT_AST,
 
 	COND_AST
 
@@ -60,12 +66,10 @@ typedef enum {
 	NOT_OP
 } OpType;
 
-typedef struct {
-    int first_line;
-    int first_column;
-    int last_line;
-    int last_column;
-} Loc;
+// Source location of a node: the byte offset of its first character in the
+// source file.  Line and column are only decoded when a message needs them,
+// see MsgFactory::getLineColumn().
+typedef unsigned int SrcLoc;
 
 typedef enum {
 	INT_TYPE,
@@ -102,17 +106,45 @@ typedef struct ValueTypeStuct{
 	ConstVal constVal;
 } ValueTypeS;
 
-
+// A folded constant of atom type 'from' converted to atom type 'to' the way
+// the generated code would (float is single precision, char is signed).
+ConstVal castConstVal(ConstVal val, ValueType from, ValueType to);
+
+
+// Ownership of the AST.
+//
+// Everything allocated while compiling one file is owned by the AST and
+// released together by clearAstNodes() (see parser.y): every Node is
+// registered in astNodes, and the pieces of a declared ValueTypeS that live
+// on the heap (the atom chain, the struct name) come from the pools below.
+// ValueTypeS itself stays a plain struct that is freely copied, the copies
+// only borrow these pointers.
+ValueTypeS *newValueType();
+std::string *adoptTypeName(std::string *name);
+void clearTypePool();
+
+// Node ids are handed out in creation order, starting from 0 for every file,
+// so tables indexed by Node::id need nodeIdBound() slots (see TypeTable).
+unsigned int nodeIdBound();
+void resetNodeIds();
+
+
+// Every node carries its NodeType in 'type', which the visitors in visitor.h
+// switch on to dispatch statically (there is no virtual accept()).
+//
+// The AST is not changed after parsing: valueTy is the type the parser
+// declared for the node (NO_TYPE for expressions), types and constants worked
+// out by the checker are kept in a TypeTable indexed by 'id'.
 class Node {
 public:
     Node();
 	virtual ~Node();
-    void setLoc(Loc* loc);
-	virtual void accept(Visitor &visitor) = 0;
+    void setLoc(SrcLoc loc);
 
 	ValueTypeS valueTy;
     NodeType type;
-    Loc* loc;
+    SrcLoc loc;
+	unsigned int id;
 };
 
 class NodeList : public Node{
@@ -121,15 +153,12 @@ public:
 	NodeList();
 	~NodeList();
 	void append(Node *node);
-	virtual void accept(Visitor &visitor);
 
 	list<Node*> nodes;
 };
 
 
 class ExpNode : public Node {
-public:
-	virtual void accept(Visitor &visitor) = 0;
 };
 
 
@@ -137,7 +166,6 @@ class NumNode : public ExpNode {
 public:
     NumNode(int val);
 	~NumNode();
-	virtual void accept(Visitor &visitor);
 
     int val;
 };
@@ -147,7 +175,6 @@ class FNumNode : public ExpNode {
 public:
     FNumNode(double fval);
 	~FNumNode();
-	virtual void accept(Visitor &visitor);
 
     double fval;
 };
@@ -157,7 +184,6 @@ class CharNode : public ExpNode {
 public:
 	CharNode(char cval);
 	~CharNode();
-	virtual void accept(Visitor &visitor);
 
 	char cval;
 };
@@ -167,7 +193,6 @@ class BinaryExpNode : public ExpNode {
 public:
     BinaryExpNode(char op, ExpNode *lhs, ExpNode *rhs);
 	~BinaryExpNode();
-	virtual void accept(Visitor &visitor);
 
     char op;
     ExpNode *lhs, *rhs;
@@ -178,7 +203,6 @@ class UnaryExpNode : public ExpNode {
 public:
     UnaryExpNode(char op, ExpNode *operand);
 	~UnaryExpNode();
-	virtual void accept(Visitor &visitor);
 
     char op;
     ExpNode *operand;
@@ -190,7 +214,6 @@ class IdNode : public ExpNode {
 public:
     IdNode(std::string* name);
 	~IdNode();
-	virtual void accept(Visitor &visitor);
 
     std::string *name;
 };
@@ -200,7 +223,6 @@ class ArrayItemNode : public ExpNode {
 public:
 	ArrayItemNode(ExpNode *array, NodeList *index);
 	~ArrayItemNode();
-	virtual void accept(Visitor &visitor);
 
 	ExpNode *array;
 	NodeList *index;
@@ -211,7 +233,6 @@ class StructItemNode : public ExpNode {
 public:
 	StructItemNode(ExpNode *stru, std::string *itemName, bool isPointer);
 	~StructItemNode();
-	virtual void accept(Visitor &visitor);
 
 	ExpNode *stru;
 	std::string *itemName;
@@ -223,7 +244,6 @@ class FunCallNode : public ExpNode {
 public:
 	FunCallNode(ExpNode *func, NodeList *argv);
 	~FunCallNode();
-	virtual void accept(Visitor &visitor);
 
     bool hasArgs;
     NodeList *argv;
@@ -233,8 +253,6 @@ public:
 
 class VarDefNode : public Node {
 public:
-	virtual void accept(Visitor &visitor) = 0;
-
 	bool isAssigned;
 	std::string *name;
 };
@@ -244,7 +262,6 @@ class IdVarDefNode : public VarDefNode {
 public:
 	IdVarDefNode(std::string *name, ExpNode *value);
 	~IdVarDefNode();
-	virtual void accept(Visitor &visitor);
 	
 	ExpNode *value;
 };
@@ -254,27 +271,20 @@ class ArrayVarDefNode : public VarDefNode {
 public:
 	ArrayVarDefNode(std::string *name, NodeList *values);
 	~ArrayVarDefNode();
-	virtual void accept(Visitor &visitor);
 
 	NodeList *values;
 };
 
 
 class BlockItemNode : public Node {
-public:
-	virtual void accept(Visitor &visitor) = 0;
 };
 
 
 class DeclNode : public BlockItemNode {
-public:
-	virtual void accept(Visitor &visitor) = 0;
 };
 
 
 class StmtNode : public BlockItemNode{
-public:
-	virtual void accept(Visitor &visitor) = 0;
 };
 
 
@@ -283,7 +293,6 @@ class EmptyNode : public StmtNode {
 public:
 	EmptyNode();
 	~EmptyNode();
-	virtual void accept(Visitor &visitor);
 };
 
 
@@ -291,7 +300,6 @@ class BlockNode : public Node {
 public:
 	BlockNode(NodeList *blockItems);
 	~BlockNode();
-	virtual void accept(Visitor &visitor);
 
 	NodeList *blockItems;
 };
@@ -301,7 +309,6 @@ class VarDeclNode : public DeclNode {
 public:
 	VarDeclNode(NodeList *defList);
 	~VarDeclNode();
-	virtual void accept(Visitor &visitor);
 	
 	NodeList *defList;
 };
@@ -309,12 +316,13 @@ public:
 
 class AssignStmtNode : public StmtNode {
 public:
-	AssignStmtNode(ExpNode *lval, ExpNode *exp);
+	AssignStmtNode(ExpNode *lval, ExpNode *exp, char op = '=');
 	~AssignStmtNode();
-	virtual void accept(Visitor &visitor);
 	
 	ExpNode *lval;
 	ExpNode *exp;
+	char op;	// '=', or the operator of a compound assignment
+
 };
 
 
@@ -322,7 +330,6 @@ class FunCallStmtNode : public StmtNode {
 public:
 	FunCallStmtNode(FunCallNode *funCall);
 	~FunCallStmtNode();
-	virtual void accept(Visitor &visitor);
 
 	FunCallNode *funCall;
 };
@@ -332,7 +339,6 @@ class BlockStmtNode : public StmtNode {
 public:
 	BlockStmtNode(BlockNode *block);
 	~BlockStmtNode();
-	virtual void accept(Visitor &visitor);
 
 	BlockNode *block;
 };
@@ -342,7 +348,6 @@ class CondNode : public Node {
 public:
 	CondNode(OpType op, Node *lhs, Node *rhs);
 	~CondNode();
-	virtual void accept(Visitor &visitor);
 
 	OpType op;
 	Node *lhs;
@@ -354,7 +359,6 @@ class IfStmtNode : public StmtNode {
 public:
 	IfStmtNode(CondNode *cond, StmtNode *then_stmt, StmtNode *else_stmt);
 	~IfStmtNode();
-	virtual void accept(Visitor &visitor);
 
 	bool hasElse;
 	CondNode *cond;
@@ -367,19 +371,34 @@ class WhileStmtNode : public StmtNode {
 public:
 	WhileStmtNode(CondNode *cond, StmtNode *do_stmt);
 	~WhileStmtNode();
-	virtual void accept(Visitor &visitor);
 
 	CondNode *cond;
 	StmtNode *do_stmt;
 };
 
 
+// any of init, cond and step may be missing (NULL)
+class ForStmtNode : public StmtNode {
+public:
+	ForStmtNode(StmtNode *init, CondNode *cond, StmtNode *step, StmtNode *do_stmt);
+	~ForStmtNode();
+
+	bool hasInit;
+	bool hasCond;
+	bool hasStep;
+	StmtNode *init;
+	CondNode *cond;
+	StmtNode *step;
+	StmtNode *do_stmt;
+};
+
+
 class ReturnStmtNode : public StmtNode {
 public:
 	ReturnStmtNode(ExpNode *exp);
 	~ReturnStmtNode();
-	virtual void accept(Visitor &visitor);
 
+	bool hasExp;
 	ExpNode *exp;
 };
 
@@ -388,7 +407,6 @@ class BreakStmtNode : public StmtNode {
 public:
 	BreakStmtNode();
 	~BreakStmtNode();
-	virtual void accept(Visitor &visitor);
 };
 
 
@@ -396,7 +414,6 @@ class ContinueStmtNode : public StmtNode {
 public:
 	ContinueStmtNode();
 	~ContinueStmtNode();
-	virtual void accept(Visitor &visitor);
 };
 
 
@@ -405,7 +422,6 @@ public:
 	FuncDeclNode(std::string *name, bool hasArgs);
 	~FuncDeclNode();
 	void append(std::string name, ValueTypeS type);
-	virtual void accept(Visitor &visitor);
 
 	bool hasArgs;
 	std::string *name;
@@ -416,7 +432,6 @@ class FuncDefNode : public Node {
 public:
 	FuncDefNode(FuncDeclNode *decl, BlockNode *block);
 	~FuncDefNode();
-	virtual void accept(Visitor &visitor);
 
 	FuncDeclNode *decl;
 	BlockNode *block;
@@ -426,7 +441,6 @@ class StructDefNode : public Node {
 public:
 	StructDefNode(std::string *name, NodeList *decls);
 	~StructDefNode();
-	virtual void accept(Visitor &visitor);
 
 	std::string *name;
 	NodeList *decls;
@@ -437,7 +451,6 @@ public:
 	CompUnitNode(Node *node);
 	~CompUnitNode();
 	void append(Node *node);
-	virtual void accept(Visitor &visitor);
 
 	list<Node*> nodes;
 };
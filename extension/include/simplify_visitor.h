@@ -0,0 +1,66 @@
+#ifndef _SIMPLIFY_VISITOR_H_
+#define _SIMPLIFY_VISITOR_H_
+
+#include "visitor.h"
+#include "type_table.h"
+#include "msgfactory.h"
+
+
+// Prunes the statements of the checked AST that can never run, so the passes
+// after it do not lower them at all.
+//
+// visit() returns whether control can fall through the end of a statement.
+// A statement following one that cannot, i.e. a return, break or continue,
+// an if whose branches all jump, or a loop that is only left by returning, is
+// unreachable: it and the rest of its block are pruned, with one warning at
+// the first of them.  The branch an if with a folded condition does not take,
+// and the body of a loop whose condition folded to false, are pruned without
+// a warning, since constant conditions are usually there on purpose.
+class SimplifyVisitor : public Visitor<SimplifyVisitor, bool> {
+public:
+	SimplifyVisitor(TypeTable &types, MsgFactory &msgs);
+	~SimplifyVisitor();
+
+	bool visitNodeList(NodeList *node);
+	bool visitNumNode(NumNode *node);
+	bool visitFNumNode(FNumNode *node);
+	bool visitCharNode(CharNode *node);
+	bool visitBinaryExpNode(BinaryExpNode *node);
+	bool visitUnaryExpNode(UnaryExpNode *node);
+	bool visitIdNode(IdNode *node);
+	bool visitArrayItemNode(ArrayItemNode *node);
+	bool visitStructItemNode(StructItemNode *node);
+	bool visitFunCallNode(FunCallNode *node);
+	bool visitIdVarDefNode(IdVarDefNode *node);
+	bool visitArrayVarDefNode(ArrayVarDefNode *node);
+	bool visitEmptyNode(EmptyNode *node);
+	bool visitBlockNode(BlockNode *node);
+	bool visitVarDeclNode(VarDeclNode *node);
+	bool visitAssignStmtNode(AssignStmtNode *node);
+	bool visitFunCallStmtNode(FunCallStmtNode *node);
+	bool visitBlockStmtNode(BlockStmtNode *node);
+	bool visitCondNode(CondNode *node);
+	bool visitIfStmtNode(IfStmtNode *node);
+	bool visitWhileStmtNdoe(WhileStmtNode *node);
+	bool visitForStmtNode(ForStmtNode *node);
+	bool visitReturnStmtNdoe(ReturnStmtNode *node);
+	bool visitBreakStmtNode(BreakStmtNode *node);
+	bool visitContinueStmtNode(ContinueStmtNode *node);
+	bool visitFuncDeclNode(FuncDeclNode *node);
+	bool visitFuncDefNode(FuncDefNode *node);
+	bool visitStructDefNode(StructDefNode *node);
+	bool visitCompUnitNode(CompUnitNode *node);
+
+private:
+	TypeTable &types;
+	MsgFactory &msgs;
+
+	bool breaks;	// the innermost loop has a reachable break
+
+	// -1 if cond was not folded, else its value
+	int folded(CondNode *cond) const;
+};
+
+
+
+#endif /* _SIMPLIFY_VISITOR_H_ */
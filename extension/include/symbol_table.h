@@ -0,0 +1,67 @@
+#ifndef _SYMBOL_TABLE_H_
+#define _SYMBOL_TABLE_H_
+
+#include <string>
+#include <vector>
+#include "node.h"
+
+
+// Scoped symbol table used by the checker.
+//
+// All scopes share one open-addressing hash table keyed by name.  A slot
+// points at the innermost visible binding of its name, and every binding
+// remembers the one it shadows.  Bindings are pushed on a single stack that
+// doubles as the undo log: leaving a scope pops the bindings made since it was
+// entered and puts the shadowed ones back.  Entering a scope only records the
+// stack height, and the nesting depth is not limited.
+class SymbolTable {
+public:
+	SymbolTable();
+
+	void enterScope();
+	void exitScope();
+	int depth() const;
+
+	// false if name is already declared in the innermost scope
+	bool declare(const std::string &name, const ValueTypeS &vType, const Node *decl);
+	// NULL if name is not visible, otherwise *decl is set to its declaration
+	const ValueTypeS *lookUp(const std::string &name, const Node **decl) const;
+	// whether the visible binding of name is in the outermost scope
+	bool isGlobal(const std::string &name) const;
+
+	// Number of bindings made so far.  A copy of the table can be rewound to
+	// an earlier height, and later brought forward by replaying the bindings
+	// of the original, so that it sees the globals declared up to some point.
+	int height() const;
+	void rewind(int height);
+	void replay(const SymbolTable &from, int height);
+
+private:
+	struct Slot {
+		std::string name;
+		unsigned int hash;
+		int binding;	// innermost visible binding, -1 if none
+		bool used;
+	};
+
+	struct Binding {
+		int slot;
+		int shadowed;	// binding hidden by this one, -1 if none
+		int scope;
+		ValueTypeS vType;
+		const Node *decl;
+	};
+
+	std::vector<Slot> slots;
+	unsigned int usedSlots;
+	std::vector<Binding> bindings;
+	std::vector<int> scopeStart;	// bindings.size() when each scope was entered
+
+	static unsigned int hashName(const std::string &name);
+	int findSlot(const std::string &name, unsigned int hash) const;
+	void grow();
+};
+
+
+
+#endif /* _SYMBOL_TABLE_H_ */
@@ -0,0 +1,65 @@
+#ifndef _TYPE_TABLE_H_
+#define _TYPE_TABLE_H_
+
+#include <vector>
+#include <list>
+#include <pthread.h>
+#include "node.h"
+
+
+// Types, folded constants and name bindings worked out by CheckVisitor, kept
+// beside the AST instead of in it.
+//
+// Slots are indexed by Node::id and sized for the whole AST when the table is
+// created, so they never move: passes working on disjoint parts of the tree
+// write disjoint slots.  A node without a slot reads as its declared type
+// (Node::valueTy).  Types built by the checker (resolved arrays, '&' results)
+// are owned by the table; newType and newBase may be called from several
+// threads at once.
+//
+// Every IdNode is bound to the node that declared its name (a VarDefNode, a
+// FuncDeclNode or an argument IdNode), so later passes can key what they
+// know about a variable by the id of its declaration instead of by name.
+//
+// Statements SimplifyVisitor found can never run are marked pruned; the passes
+// after it skip them.
+class TypeTable {
+public:
+	TypeTable(unsigned int size);
+	~TypeTable();
+
+	const ValueTypeS &operator[](const Node *node) const;
+	ValueTypeS &annotate(const Node *node);
+
+	void bind(const IdNode *use, const Node *decl);
+	const Node *declOf(const IdNode *use) const;
+
+	// index of the member a StructItemNode selects, see StructLayout
+	void setField(const StructItemNode *item, int index);
+	int fieldOf(const StructItemNode *item) const;
+
+	void prune(const Node *stmt);
+	bool pruned(const Node *stmt) const;
+
+	ValueTypeS *newType(const ValueTypeS &vType);
+	int *newBase(int dim);
+
+private:
+	std::vector<ValueTypeS> types;
+	std::vector<char> present;
+	std::vector<const Node *> decls;
+	std::vector<int> fields;
+	std::vector<char> dead;
+
+	std::list<ValueTypeS *> ownedTypes;
+	std::list<int *> ownedBases;
+	pthread_mutex_t ownedLock;
+
+	// not copyable, it owns the types above
+	TypeTable(const TypeTable &);
+	TypeTable &operator=(const TypeTable &);
+};
+
+
+
+#endif /* _TYPE_TABLE_H_ */
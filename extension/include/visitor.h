@@ -3,50 +3,85 @@
 
 #include "node.h"
 
+// Statically dispatched visitor (CRTP).
+//
+// A pass derives from Visitor<Pass, RetTy> and defines every visitXXX method
+// below with the same signature.  visit() switches on Node::type and calls the
+// derived method directly, so the dispatch can be inlined and each visit hands
+// its result back as a return value instead of through a side stack.
+//
+// The traversal order is not fixed: each visitXXX decides whether and when to
+// visit the children of its node by calling visit() on them.
+template <typename Derived, typename RetTy = void>
 class Visitor {
 public:
-	Visitor(){orderChanged = false;}
-	virtual ~Visitor(){};
+	RetTy visit(Node *node)
+	{
+		Derived *d = static_cast<Derived *>(this);
 
-
-	virtual void visitNodeList(NodeList *node) = 0;
-	virtual void visitNumNode(NumNode *node) = 0;
-	virtual void visitFNumNode(FNumNode *node) = 0;
-	virtual void visitCharNode(CharNode *node) = 0;
-	virtual void visitBinaryExpNode(BinaryExpNode *node) = 0;
-	virtual void visitUnaryExpNode(UnaryExpNode *node) = 0;
-	virtual void visitIdNode(IdNode *node) = 0;
-	virtual void visitArrayItemNode(ArrayItemNode *node) = 0;
-	virtual void visitStructItemNode(StructItemNode *node) = 0;
-	virtual void visitFunCallNode(FunCallNode *node) = 0;
-	virtual void visitIdVarDefNode(IdVarDefNode *node) = 0;
-	virtual void visitArrayVarDefNode(ArrayVarDefNode *node) = 0;
-	virtual void visitEmptyNode(EmptyNode *node) = 0;
-	virtual void visitBlockNode(BlockNode *node) = 0;
-	virtual void visitVarDeclNode(VarDeclNode *node) = 0;
-	virtual void visitAssignStmtNode(AssignStmtNode *node) = 0;
-	virtual void visitFunCallStmtNode(FunCallStmtNode *node) = 0;
-	virtual void visitBlockStmtNode(BlockStmtNode *node) = 0;
-	virtual void visitCondNode(CondNode *node) = 0;
-	virtual void visitIfStmtNode(IfStmtNode *node) = 0;
-	virtual void visitWhileStmtNdoe(WhileStmtNode *node) = 0;
-	virtual void visitReturnStmtNdoe(ReturnStmtNode *node) = 0;
-	virtual void visitBreakStmtNode(BreakStmtNode *node) = 0;
-	virtual void visitContinueStmtNode(ContinueStmtNode *node) = 0;
-	virtual void visitFuncDeclNode(FuncDeclNode *node) = 0;
-	virtual void visitFuncDefNode(FuncDefNode *node) = 0;
-	virtual void visitStructDefNode(StructDefNode *node) = 0;
-	virtual void visitCompUnitNode(CompUnitNode *node) = 0;
-
-	virtual void enterBlockNode(BlockNode *node) = 0;
-	virtual void enterIfStmtNode(IfStmtNode *node) = 0;
-	virtual void enterWhileStmtNode(WhileStmtNode *node) = 0;
-	virtual void enterFuncDefNode(FuncDefNode *node) = 0;
-	virtual void enterStructDefNode(StructDefNode *node) = 0;
-
-	bool orderChanged;
-
-private:
+		switch (node->type) {
+		case NODE_LIST_AST:
+			return d->visitNodeList(static_cast<NodeList *>(node));
+		case NUM_AST:
+			return d->visitNumNode(static_cast<NumNode *>(node));
+		case FNUM_AST:
+			return d->visitFNumNode(static_cast<FNumNode *>(node));
+		case CHAR_AST:
+			return d->visitCharNode(static_cast<CharNode *>(node));
+		case ID_AST:
+			return d->visitIdNode(static_cast<IdNode *>(node));
+		case ARRAY_ITEM_AST:
+			return d->visitArrayItemNode(static_cast<ArrayItemNode *>(node));
+		case STRUCT_ITEM_AST:
+			return d->visitStructItemNode(static_cast<StructItemNode *>(node));
+		case BINARY_EXP_AST:
+			return d->visitBinaryExpNode(static_cast<BinaryExpNode *>(node));
+		case UNARY_EXP_AST:
+			return d->visitUnaryExpNode(static_cast<UnaryExpNode *>(node));
+		case FUN_CALL_AST:
+			return d->visitFunCallNode(static_cast<FunCallNode *>(node));
+		case ID_VAR_DEF_AST:
+			return d->visitIdVarDefNode(static_cast<IdVarDefNode *>(node));
+		case ARRAY_VAR_DEF_AST:
+			return d->visitArrayVarDefNode(static_cast<ArrayVarDefNode *>(node));
+		case BLOCK_AST:
+			return d->visitBlockNode(static_cast<BlockNode *>(node));
+		case VAR_DECL_AST:
+			return d->visitVarDeclNode(static_cast<VarDeclNode *>(node));
+		case STRUCT_DEF_AST:
+			return d->visitStructDefNode(static_cast<StructDefNode *>(node));
+		case EMPTY_STMT_AST:
+			return d->visitEmptyNode(static_cast<EmptyNode *>(node));
+		case ASSIGN_STMT_AST:
+			return d->visitAssignStmtNode(static_cast<AssignStmtNode *>(node));
+		case FUNCALL_STMT_AST:
+			return d->visitFunCallStmtNode(static_cast<FunCallStmtNode *>(node));
+		case BLOCK_STMT_AST:
+			return d->visitBlockStmtNode(static_cast<BlockStmtNode *>(node));
+		case IF_STMT_AST:
+			return d->visitIfStmtNode(static_cast<IfStmtNode *>(node));
+		case WHILE_STMT_AST:
+			return d->visitWhileStmtNdoe(static_cast<WhileStmtNode *>(node));
+		case FOR_STMT_AST:
+			return d->visitForStmtNode(static_cast<ForStmtNode *>(node));
+		case RETURN_STMT_AST:
+			return d->visitReturnStmtNdoe(static_cast<ReturnStmtNode *>(node));
+		case BREAK_STMT_AST:
+			return d->visitBreakStmtNode(static_cast<BreakStmtNode *>(node));
+		case CONTINUE_STMT_AST:
+			return d->visitContinueStmtNode(static_cast<ContinueStmtNode *>(node));
+		case FUNC_DECL_AST:
+			return d->visitFuncDeclNode(static_cast<FuncDeclNode *>(node));
+		case FUNC_DEF_AST:
+			return d->visitFuncDefNode(static_cast<FuncDefNode *>(node));
+		case COMP_UNIT_AST:
+			return d->visitCompUnitNode(static_cast<CompUnitNode *>(node));
+		case COND_AST:
+			return d->visitCondNode(static_cast<CondNode *>(node));
+		default:
+			return RetTy();
+		}
+	}
 };
 
 
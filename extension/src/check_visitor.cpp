@@ -1,21 +1,20 @@
 #include <cstdio>
+#include <climits>
 #include <map>
 #include <vector>
 #include <list>
+#include <pthread.h>
+#include <unistd.h>
 
 #include "check_visitor.h"
 #include "node.h"
 #include "msgfactory.h"
 
-extern MsgFactory msgFactory;
-extern bool errorFlag;
-
-extern std::list<Node *> astNodes;
 
 using namespace std;
 
 
-static void printType(ValueTypeS vType)
+static void printType(const TypeTable &types, ValueTypeS vType)
 {
 	if (vType.isConstant)
 		printf("const ");
@@ -31,12 +30,12 @@ static void printType(ValueTypeS vType)
 		return;
 	case PTR_TYPE:
 		printf("pointer( ");
-		printType(*(vType.atom));
+		printType(types, *(vType.atom));
 		printf(" )");
 		return;
 	case ARRAY_TYPE:
 		printf("array( ");
-		printType(*(vType.atom));
+		printType(types, *(vType.atom));
 		for (int i = 0; i < vType.dim; i++)
 			printf(" ,%d", vType.base[i]);
 		printf(" )");
@@ -49,12 +48,12 @@ static void printType(ValueTypeS vType)
 		if (vType.argv != NULL) {
 			for (std::list<Node *>::iterator it = vType.argv->nodes.begin();
 					it != vType.argv->nodes.end(); it++) {
-				printType((*it)->valueTy);
+				printType(types, types[*it]);
 				printf(", ");
 			}
 		}
 		printf(" ) -> ");
-		printType(*(vType.atom));
+		printType(types, *(vType.atom));
 		return;
 	case VOID_TYPE:
 		printf("void");
@@ -65,14 +64,14 @@ static void printType(ValueTypeS vType)
 }
 
 
-static bool typeIsEqual(ValueTypeS *a, ValueTypeS *b)
+static bool typeIsEqual(const TypeTable &types, const ValueTypeS *a, const ValueTypeS *b)
 {
 	if (a->type != b->type) {
 		// special case for function pointer
 		if (a->type == PTR_TYPE && a->atom->type == FUNC_TYPE && b->type == FUNC_TYPE)
-			return typeIsEqual(a->atom, b);
+			return typeIsEqual(types, a->atom, b);
 		else if(b->type == PTR_TYPE && b->atom->type == FUNC_TYPE && a->type == FUNC_TYPE)
-			return typeIsEqual(a, b->atom);
+			return typeIsEqual(types, a, b->atom);
 		else
 			return false;
 	}
@@ -83,24 +82,27 @@ static bool typeIsEqual(ValueTypeS *a, ValueTypeS *b)
 		for (int i = 1; i < a->dim; i++)	// i count from 1
 			if (a->base[i] != b->base[i])
 				return false;
-		return typeIsEqual(a->atom, b->atom);
+		return typeIsEqual(types, a->atom, b->atom);
 	}
 
 	else if (a->type == PTR_TYPE)
-		return typeIsEqual(a->atom, b->atom);
+		return typeIsEqual(types, a->atom, b->atom);
 	else if (a->type == STRUCT_TYPE)
 		return *(a->structName) == *(b->structName);
 
 	else if (a->type == FUNC_TYPE) {
-		if (!typeIsEqual(a->atom, b->atom))
+		if (!typeIsEqual(types, a->atom, b->atom))
 			return false;
+		// a function without parameters has no argument list
+		if (a->argv == NULL || b->argv == NULL)
+			return a->argv == b->argv;
 		list<Node *> argvA = a->argv->nodes;
 		list<Node *> argvB = b->argv->nodes;
 		if (argvA.size() != argvB.size())
 			return false;
 		for (list<Node *>::iterator itA = argvA.begin(), itB = argvB.begin();
 				itA != argvA.end(); itA++, itB++) {
-			if (!typeIsEqual(&(*itA)->valueTy, &(*itB)->valueTy))
+			if (!typeIsEqual(types, &types[*itA], &types[*itB]))
 				return false;
 		}
 		return true;
@@ -111,34 +113,6 @@ static bool typeIsEqual(ValueTypeS *a, ValueTypeS *b)
 }
 
 
-static ExpNode *getSimpleNode(ValueTypeS vType, Loc *loc)
-{
-	ExpNode *node;
-	ConstVal val = vType.constVal;
-
-	switch (vType.type) {
-	case INT_TYPE:
-		node = new NumNode(val.ival);
-		break;
-	case FLOAT_TYPE:
-		node = new FNumNode(val.fval);
-		break;
-	case CHAR_TYPE:
-		node = new CharNode(val.cval);
-		break;
-	default:
-		return NULL;
-	}
-
-	node->valueTy = vType;
-	node->setLoc(loc);
-
-	astNodes.push_back(node);
-
-	return node;
-}
-
-
 static bool isAtomType(ValueTypeS vType)
 {
 	return vType.type == INT_TYPE || vType.type == FLOAT_TYPE || vType.type == CHAR_TYPE;
@@ -155,12 +129,11 @@ static ValueTypeS typeUp(ValueTypeS *ta, ValueTypeS *tb)
 			return retT;
 		}
 
-		if (ta->type == INT_TYPE || tb->type == INT_TYPE) {
-			ta->dstType = INT_TYPE;
-			tb->dstType = INT_TYPE;
-			retT.type = INT_TYPE;
-			return retT;
-		}
+		// int with int or char, and char with char, are done in int
+		ta->dstType = INT_TYPE;
+		tb->dstType = INT_TYPE;
+		retT.type = INT_TYPE;
+		return retT;
 	}
 
 	retT.type = NO_TYPE;
@@ -168,9 +141,115 @@ static ValueTypeS typeUp(ValueTypeS *ta, ValueTypeS *tb)
 }
 
 
+// Constant folding.  Operands are converted to the type the operation is done
+// in, int arithmetic wraps like the generated add/sub/mul, and whatever would
+// trap at run time (division by zero, INT_MIN / -1) is left to run time.
+static bool foldArith(char op, ValueType type, const ValueTypeS &lhs,
+		const ValueTypeS &rhs, ConstVal *val)
+{
+	ConstVal l = castConstVal(lhs.constVal, lhs.type, type);
+	ConstVal r = castConstVal(rhs.constVal, rhs.type, type);
+
+	if (type == FLOAT_TYPE) {
+		float a = l.fval, b = r.fval;
+		switch (op) {
+		case '+': val->fval = a + b; return true;
+		case '-': val->fval = a - b; return true;
+		case '*': val->fval = a * b; return true;
+		case '/': val->fval = a / b; return true;
+		default: return false;
+		}
+	}
+
+	if (type != INT_TYPE)
+		return false;
+
+	unsigned int a = l.ival, b = r.ival;
+	switch (op) {
+	case '+': val->ival = (int)(a + b); return true;
+	case '-': val->ival = (int)(a - b); return true;
+	case '*': val->ival = (int)(a * b); return true;
+	case '/':
+	case '%':
+		if (r.ival == 0 || (l.ival == INT_MIN && r.ival == -1))
+			return false;
+		val->ival = op == '/' ? l.ival / r.ival : l.ival % r.ival;
+		return true;
+	default:
+		return false;
+	}
+}
+
+// An item of a const one-dimensional array picked by a constant index is
+// known if the array was initialized with constants: items past the end of
+// the initializer list are 0.
+static bool foldArrayItem(const TypeTable &types, ArrayItemNode *node, ValueTypeS *vType)
+{
+	const ValueTypeS &arrayTy = types[node->array];
+	if (node->array->type != ID_AST || arrayTy.dim != 1 || node->index->nodes.size() != 1)
+		return false;
+
+	const ValueTypeS &indexTy = types[node->index->nodes.front()];
+	const Node *decl = types.declOf((IdNode *)node->array);
+	if (!indexTy.isComputed || decl == NULL || decl->type != ARRAY_VAR_DEF_AST)
+		return false;
+
+	const ArrayVarDefNode *def = (const ArrayVarDefNode *)decl;
+	if (!types[def].isConstant || !def->isAssigned || !isAtomType(*vType))
+		return false;
+
+	int index = indexTy.constVal.ival;
+	if (index < 0 || index >= arrayTy.base[0])
+		return false;
+
+	list<Node *> &items = def->values->nodes;
+	list<Node *>::iterator it = items.begin();
+	for (int i = 0; i < index && it != items.end(); i++)
+		it++;
+
+	if (it == items.end()) {
+		ConstVal zero;
+		zero.ival = 0;
+		vType->constVal = castConstVal(zero, INT_TYPE, vType->type);
+		return true;
+	}
+
+	const ValueTypeS &itemTy = types[*it];
+	if (!itemTy.isComputed)
+		return false;
+	vType->constVal = castConstVal(itemTy.constVal, itemTy.type, vType->type);
+	return true;
+}
+
+// comparisons are done in float if either side is a float, else in int
+static int foldCompare(OpType op, const ValueTypeS &lhs, const ValueTypeS &rhs)
+{
+	double a, b;
+
+	if (lhs.type == FLOAT_TYPE || rhs.type == FLOAT_TYPE) {
+		a = (float)castConstVal(lhs.constVal, lhs.type, FLOAT_TYPE).fval;
+		b = (float)castConstVal(rhs.constVal, rhs.type, FLOAT_TYPE).fval;
+	}
+	else {
+		a = castConstVal(lhs.constVal, lhs.type, INT_TYPE).ival;
+		b = castConstVal(rhs.constVal, rhs.type, INT_TYPE).ival;
+	}
+
+	switch (op) {
+	case LT_OP:		return a < b;
+	case GT_OP:		return a > b;
+	case LTE_OP:	return a <= b;
+	case GTE_OP:	return a >= b;
+	case EQ_OP:		return a == b;
+	case NEQ_OP:	return a != b;
+	default:		return 0;
+	}
+}
+
+
 void CheckVisitor::handleArrayType(ValueTypeS *vType)
 {
-	if (errorFlag)
+	if (hasError)
 		return;
 
 	list<Node *> nodes;
@@ -183,7 +262,7 @@ void CheckVisitor::handleArrayType(ValueTypeS *vType)
 
 		vType->dim = nodes.size();
 
-		vType->base = new int[vType->dim];
+		vType->base = types.newBase(vType->dim);
 		i = 0;
 		for (list<Node *>::iterator it = nodes.begin();
 				it != nodes.end(); it++, i++) {
@@ -194,45 +273,51 @@ void CheckVisitor::handleArrayType(ValueTypeS *vType)
 					continue;
 				}
 				else {
-					errorFlag = true;
+					hasError = true;
 					return;
 				}
 			}
 
-			(*it)->accept(*this);
+			visit(*it);
 
-			sizeTy = (*it)->valueTy;
+			sizeTy = types[*it];
 
-			if (errorFlag)
+			if (hasError)
 				return;
-			if (sizeTy.type != INT_TYPE) {
-				errorFlag = true;
+			if (sizeTy.type != INT_TYPE && sizeTy.type != CHAR_TYPE) {
+				hasError = true;
 				return;
 			}
 
-			if (sizeTy.isComputed && sizeTy.type == INT_TYPE)
-				vType->base[i] = sizeTy.constVal.ival;
+			if (sizeTy.isComputed)
+				vType->base[i] = castConstVal(sizeTy.constVal, sizeTy.type, INT_TYPE).ival;
 			else {
-				errorFlag = true;
-				msgFactory.newError(e_array_size_not_constant, (*it)->loc->first_line, (*it)->loc->first_column);
+				hasError = true;
+				msgs.newError(e_array_size_not_constant, (*it)->loc);
 				return;
 			}
 		}
 		//vType->argv = NULL;
+		vType->atom = types.newType(*vType->atom);
 		handleArrayType(vType->atom);
 		return;
 	case PTR_TYPE:
+		vType->atom = types.newType(*vType->atom);
 		handleArrayType(vType->atom);
 		return;
+	case STRUCT_TYPE:
+		noteUse("struct." + *vType->structName);
+		return;
 	case FUNC_TYPE:
+		vType->atom = types.newType(*vType->atom);
 		handleArrayType(vType->atom);
-		if (errorFlag)
+		if (hasError)
 			return;
 		if (vType->argv != NULL) {
 			nodes = vType->argv->nodes;
 			for (list<Node*>::iterator it = nodes.begin();
 					it != nodes.end(); it++) {
-				handleArrayType(&(*it)->valueTy);
+				handleArrayType(&types.annotate(*it));
 			}
 		}
 		return;
@@ -242,31 +327,71 @@ void CheckVisitor::handleArrayType(ValueTypeS *vType)
 }
 
 
-ValueTypeS CheckVisitor::lookUpSym(string name)
+// size and alignment in bytes of a variable of type vType
+void CheckVisitor::getSizeAlign(const ValueTypeS &vType, int *size, int *align)
 {
-	int sp = stackPtr;
-	while (sp > 0) {
-		map<string, ValueTypeS> &symTable = *symTableStack[sp-1];
-		if (symTable.find(name) != symTable.end())
-			return symTable[name];
-		sp--;
+	switch (vType.type) {
+	case INT_TYPE:
+	case FLOAT_TYPE:
+		*size = *align = 4;
+		return;
+	case CHAR_TYPE:
+		*size = *align = 1;
+		return;
+	case PTR_TYPE:
+		*size = *align = 8;
+		return;
+	case ARRAY_TYPE:
+		getSizeAlign(*vType.atom, size, align);
+		for (int i = 0; i < vType.dim; i++)
+			*size *= vType.base[i];
+		return;
+	case STRUCT_TYPE:
+	{
+		map<string, StructLayout>::iterator it = structTable.find(*vType.structName);
+		if (it != structTable.end()) {
+			*size = it->second.size;
+			*align = it->second.align;
+			return;
+		}
+		break;
+	}
+	default:
+		break;
 	}
+	*size = 0;
+	*align = 1;
+}
 
-	if (globalSymTabble.find(name) != globalSymTabble.end())
-		return globalSymTabble[name];
 
-	ValueTypeS retType;
-	retType.type = NO_TYPE;
-	return retType;
+CheckVisitor::CheckVisitor(TypeTable &types, MsgFactory &msgs)
+	: types(types), msgs(msgs)
+{
+	hasError = false;
+	visibleBefore = ~(SrcLoc)0;
+	deps = NULL;
+	curItem = -1;
+	inBody = false;
+	isGlobal = true;
+	debug = false;
+	loopDepth = 0;
+	retType = NULL;
 }
 
 
-CheckVisitor::CheckVisitor()
+CheckVisitor::CheckVisitor(const CheckVisitor &parent, MsgFactory &msgs)
+	: types(parent.types), msgs(msgs), symTable(parent.symTable),
+	  structTable(parent.structTable)
 {
-	stackPtr = 0;
+	hasError = parent.hasError;
+	visibleBefore = ~(SrcLoc)0;
+	deps = parent.deps;
+	curItem = -1;
+	inBody = false;
 	isGlobal = true;
-	debug = false;
-	orderChanged = false;
+	debug = parent.debug;
+	loopDepth = 0;
+	retType = NULL;
 }
 
 
@@ -282,15 +407,37 @@ void CheckVisitor::setDebug()
 }
 
 
+bool CheckVisitor::failed() const
+{
+	return hasError;
+}
+
+
+void CheckVisitor::setDepGraph(DepGraph *deps)
+{
+	this->deps = deps;
+}
+
+
+void CheckVisitor::noteUse(const std::string &name)
+{
+	if (deps != NULL && curItem != -1)
+		deps->use(curItem, name, inBody);
+}
+
+
 void CheckVisitor::visitNodeList(NodeList *node)
 {
-	// empty
+	for (list<Node *>::iterator it = node->nodes.begin();
+			it != node->nodes.end(); it++) {
+		visit(*it);
+	}
 }
 
 
 void CheckVisitor::visitNumNode(NumNode *node)
 {
-	ValueTypeS &vType = node->valueTy;
+	ValueTypeS &vType = types.annotate(node);
 
 	vType.type = INT_TYPE;
 	vType.dstType = NO_TYPE;
@@ -303,7 +450,7 @@ void CheckVisitor::visitNumNode(NumNode *node)
 
 void CheckVisitor::visitFNumNode(FNumNode *node)
 {
-	ValueTypeS &vType = node->valueTy;
+	ValueTypeS &vType = types.annotate(node);
 
 	vType.type = FLOAT_TYPE;
 	vType.dstType = NO_TYPE;
@@ -317,7 +464,7 @@ void CheckVisitor::visitFNumNode(FNumNode *node)
 
 void CheckVisitor::visitCharNode(CharNode *node)
 {
-	ValueTypeS &vType = node->valueTy;
+	ValueTypeS &vType = types.annotate(node);
 
 	vType.type = CHAR_TYPE;
 	vType.dstType = NO_TYPE;
@@ -331,16 +478,19 @@ void CheckVisitor::visitCharNode(CharNode *node)
 
 void CheckVisitor::visitBinaryExpNode(BinaryExpNode *node)
 {
-	if (errorFlag)
+	visit(node->lhs);
+	visit(node->rhs);
+
+	if (hasError)
 		return;
 
-	ValueTypeS &vType = node->valueTy;
-	ValueTypeS &lhsTy = node->lhs->valueTy;
-	ValueTypeS &rhsTy = node->rhs->valueTy;
+	ValueTypeS &vType = types.annotate(node);
+	ValueTypeS &lhsTy = types.annotate(node->lhs);
+	ValueTypeS &rhsTy = types.annotate(node->rhs);
 
 	if (!isAtomType(lhsTy) || !isAtomType(rhsTy)) {
-		errorFlag = false;
-		msgFactory.newError(e_type_unmatch, node->loc->first_line, node->loc->first_column);
+		hasError = true;
+		msgs.newError(e_type_unmatch, node->loc);
 		return;
 	}
 
@@ -348,90 +498,61 @@ void CheckVisitor::visitBinaryExpNode(BinaryExpNode *node)
 	vType.dstType = NO_TYPE;
 	vType.isConstant = true;
 
-	if (!typeIsEqual(&lhsTy, &rhsTy)) {
+	// chars are promoted even when both sides are chars
+	if (!typeIsEqual(types, &lhsTy, &rhsTy) || lhsTy.type == CHAR_TYPE) {
 		ValueTypeS upTy = typeUp(&lhsTy, &rhsTy);
 		if (upTy.type == NO_TYPE) {
-			errorFlag = false;
-			msgFactory.newError(e_type_unmatch, node->loc->first_line, node->loc->first_column);
+			hasError = true;
+			msgs.newError(e_type_unmatch, node->loc);
 			return;
 		}
 		vType.type = upTy.type;
 	}
 
 	if (node->op == '%' && vType.type == FLOAT_TYPE) {
-		errorFlag = false;
-		msgFactory.newError(e_float_mod, node->loc->first_line, node->loc->first_column);
+		hasError = true;
+		msgs.newError(e_float_mod, node->loc);
 		return;
 	}
 
-	if (lhsTy.isComputed)
-		node->lhs = getSimpleNode(lhsTy, node->lhs->loc);
-	if (rhsTy.isComputed)
-		node->rhs = getSimpleNode(rhsTy, node->rhs->loc);
-
-	if (lhsTy.isComputed && rhsTy.isComputed) {
-		vType.isComputed = true;
-		ConstVal lval = lhsTy.constVal;
-		ConstVal rval = rhsTy.constVal;
-		switch (vType.type) {
-		case INT_TYPE:
-			switch (node->op) {
-			case '+': vType.constVal.ival = lval.ival + rval.ival; break;
-			case '-': vType.constVal.ival = lval.ival - rval.ival; break;
-			case '*': vType.constVal.ival = lval.ival * rval.ival; break;
-			case '/': vType.constVal.ival = lval.ival / rval.ival; break;
-			case '%': vType.constVal.ival = lval.ival % rval.ival; break;
-			}
-			break;
-		case FLOAT_TYPE:
-			switch (node->op) {
-			case '+': vType.constVal.ival = lval.ival + rval.ival; break;
-			case '-': vType.constVal.ival = lval.ival - rval.ival; break;
-			case '*': vType.constVal.ival = lval.ival * rval.ival; break;
-			case '/': vType.constVal.ival = lval.ival / rval.ival; break;
-			}
-			break;
-		default:
-			break;
-		}
-	}
+	vType.isComputed = lhsTy.isComputed && rhsTy.isComputed
+		&& foldArith(node->op, vType.type, lhsTy, rhsTy, &vType.constVal);
 }
 
 
 void CheckVisitor::visitUnaryExpNode(UnaryExpNode *node)
 {
-	if (errorFlag)
-	return;
-
-	ValueTypeS &vType = node->valueTy;
-	ValueTypeS &operandTy = node->operand->valueTy;
-
+	visit(node->operand);
 
-	if (operandTy.isComputed)
-		node->operand = getSimpleNode(operandTy, node->operand->loc);
+	if (hasError)
+		return;
 
+	ValueTypeS &vType = types.annotate(node);
+	ValueTypeS &operandTy = types.annotate(node->operand);
 
 	switch (node->op) {
 	case '+':
-		if (!isAtomType(operandTy) || operandTy.type == CHAR_TYPE) {
-			errorFlag = false;
-			msgFactory.newError(e_type_unmatch, node->loc->first_line, node->loc->first_column);
-			return;
-		}
-		vType = operandTy;
-		break;
 	case '-':
-		if (!isAtomType(operandTy) || operandTy.type == CHAR_TYPE) {
-			errorFlag = false;
-			msgFactory.newError(e_type_unmatch, node->loc->first_line, node->loc->first_column);
+		if (!isAtomType(operandTy)) {
+			hasError = true;
+			msgs.newError(e_type_unmatch, node->loc);
 			return;
 		}
 		vType = operandTy;
-		if (operandTy.isComputed) {
-			if (operandTy.type == INT_TYPE)
-				vType.constVal.ival = -operandTy.constVal.ival;
+		vType.dstType = NO_TYPE;
+
+		// a char operand is promoted to int
+		if (operandTy.type == CHAR_TYPE) {
+			operandTy.dstType = INT_TYPE;
+			vType.type = INT_TYPE;
+			vType.constVal = castConstVal(operandTy.constVal, CHAR_TYPE, INT_TYPE);
+		}
+
+		if (node->op == '-' && vType.isComputed) {
+			if (vType.type == INT_TYPE)
+				vType.constVal.ival = (int)(0u - (unsigned int)vType.constVal.ival);
 			else
-				vType.constVal.fval = -operandTy.constVal.fval;
+				vType.constVal.fval = -(float)vType.constVal.fval;
 		}
 		break;
 	case '&':
@@ -444,19 +565,19 @@ void CheckVisitor::visitUnaryExpNode(UnaryExpNode *node)
 		case STRUCT_ITEM_AST:
 			vType.type = PTR_TYPE;
 			vType.dstType = NO_TYPE;
-			vType.atom = &(node->operand->valueTy);
+			vType.atom = types.newType(operandTy);
 			break;
 		default:
-			errorFlag = true;
-			msgFactory.newError(e_does_not_have_address, node->loc->first_line, node->loc->first_column);
+			hasError = true;
+			msgs.newError(e_does_not_have_address, node->loc);
 			return;
 		}	// end inner switch
 		break;
 	}	// end case '&'
 	case '*':
 		if (operandTy.type != PTR_TYPE) {
-			errorFlag = false;
-			msgFactory.newError(e_type_unmatch, node->loc->first_line, node->loc->first_column);
+			hasError = true;
+			msgs.newError(e_type_unmatch, node->loc);
 			return;
 		}
 		vType = *(operandTy.atom);
@@ -467,100 +588,153 @@ void CheckVisitor::visitUnaryExpNode(UnaryExpNode *node)
 
 void CheckVisitor::visitIdNode(IdNode *node)
 {
-	if (errorFlag)
+	if (hasError)
 		return;
 
-	ValueTypeS vType = lookUpSym(*node->name);
-	if (vType.type == NO_TYPE) {
-		errorFlag = true;
-		msgFactory.newError(e_undeclared_identifier, node->loc->first_line, node->loc->first_column);
+	const Node *decl;
+	const ValueTypeS *vType = symTable.lookUp(*node->name, &decl);
+	if (vType == NULL) {
+		hasError = true;
+		msgs.newError(e_undeclared_identifier, node->loc);
 		return;
 	}
 
-	node->valueTy = vType;
+	// resolved once here, codegen follows the binding
+	types.annotate(node) = *vType;
+	types.bind(node, decl);
+	if (symTable.isGlobal(*node->name))
+		noteUse(*node->name);
 
 }
 
 
 void CheckVisitor::visitArrayItemNode(ArrayItemNode *node)
 {
-	if (errorFlag)
+	visit(node->array);
+	visit(node->index);
+
+	if (hasError)
 		return;
 
-	ValueTypeS &vType = node->valueTy;
-	ValueTypeS &arrayTy = node->array->valueTy;
+	ValueTypeS &vType = types.annotate(node);
+	ValueTypeS &arrayTy = types.annotate(node->array);
 
 	if (arrayTy.type != ARRAY_TYPE) {
-		errorFlag = true;
-		msgFactory.newError(e_not_array_type, node->loc->first_line, node->loc->first_column);
+		hasError = true;
+		msgs.newError(e_not_array_type, node->loc);
 		return;
 	}
 
 	list<Node *> nodes = node->index->nodes;
 	for (list<Node *>::iterator it = nodes.begin();
 			it != nodes.end(); ++it) {
-		if ((*it)->valueTy.type != INT_TYPE) {
-			errorFlag = true;
-			msgFactory.newError(e_array_index_not_int, (*it)->loc->first_line, (*it)->loc->first_column);
+		if (types[*it].type != INT_TYPE) {
+			hasError = true;
+			msgs.newError(e_array_index_not_int, (*it)->loc);
 			return;
 		}
 	}
 
 	vType = *(arrayTy.atom);
+	vType.isComputed = foldArrayItem(types, node, &vType);
 }
 
 
 void CheckVisitor::visitStructItemNode(StructItemNode *node)
 {
-	if (errorFlag)
+	visit(node->stru);
+
+	if (hasError)
 		return;
 
-	ValueTypeS &vType = node->valueTy;
-	ValueTypeS struTy = node->stru->valueTy;
+	ValueTypeS &vType = types.annotate(node);
+	ValueTypeS struTy = types[node->stru];
 
 	if (node->isPointer) {
 		struTy = *(struTy.atom);
 	}
 
 	if (struTy.type != STRUCT_TYPE) {
-		errorFlag = true;
-		msgFactory.newError(e_not_a_struct, node->loc->first_line, node->loc->first_column);
+		hasError = true;
+		msgs.newError(e_not_a_struct, node->loc);
 		return;
 	}
 
-	map<string, ValueTypeS> &struAttrMap = *structTable[*struTy.structName];
+	map<string, StructLayout>::iterator stru = structTable.find(*struTy.structName);
+	if (stru == structTable.end()) {
+		hasError = true;
+		msgs.newError(e_no_such_struct, node->loc);
+		return;
+	}
 
-	vType = struAttrMap[*node->itemName];
+	StructLayout &layout = stru->second;
+	map<string, int>::iterator field = layout.indexOf.find(*node->itemName);
+	if (field == layout.indexOf.end()) {
+		hasError = true;
+		msgs.newError(e_no_such_member, node->loc);
+		return;
+	}
+
+	// codegen only needs the field index
+	vType = layout.fields[field->second].vType;
+	types.setField(node, field->second);
 }
 
 
 
 void CheckVisitor::visitFunCallNode(FunCallNode *node)
 {
-	if (errorFlag)
+	visit(node->func);
+	if (node->hasArgs)
+		visit(node->argv);
+
+	if (hasError)
 		return;
 
-	ValueTypeS &vType = node->valueTy;
+	ValueTypeS &vType = types.annotate(node);
 
-	ValueTypeS funcTy = node->func->valueTy;
+	ValueTypeS funcTy = types[node->func];
 	if (funcTy.type == PTR_TYPE)
 		funcTy = *funcTy.atom;
+	if (funcTy.type != FUNC_TYPE) {
+		hasError = true;
+		msgs.newError(e_unknown_function, node->loc);
+		return;
+	}
+
+	// the call has the type the function returns
+	vType = *funcTy.atom;
+	vType.dstType = NO_TYPE;
+	vType.isConstant = false;
+	vType.isComputed = false;
 
+	// arguments are converted to the parameter types like an assignment
 	if (node->hasArgs) {
+		if (funcTy.argv == NULL) {
+			hasError = true;
+			msgs.newError(e_argument_unmatch, node->loc);
+			return;
+		}
 		std::list<Node *> nodes1 = node->argv->nodes;
 		std::list<Node *> nodes2 = funcTy.argv->nodes;
 
 		if (nodes1.size() != nodes2.size()) {
-			errorFlag = true;
-			msgFactory.newError(e_argument_unmatch, node->loc->first_line, node->loc->first_column);
+			hasError = true;
+			msgs.newError(e_argument_unmatch, node->loc);
 			return;
 		}
 		std::list<Node *>::iterator it1 = nodes1.begin(), it2 = nodes2.begin();
 		while (it1 != nodes1.end()) {
-			if (!typeIsEqual(&(*it1)->valueTy, &(*it2)->valueTy)) {		// oh... not good..
-				errorFlag = true;
-				msgFactory.newError(e_argument_unmatch, node->loc->first_line, node->loc->first_column);
-				return;
+			ValueTypeS &argTy = types.annotate(*it1);
+			const ValueTypeS &paramTy = types[*it2];
+			if (!typeIsEqual(types, &argTy, &paramTy)) {
+				if (isAtomType(argTy) && isAtomType(paramTy))
+					argTy.dstType = paramTy.type;
+				else {
+					hasError = true;
+					msgs.newError(e_argument_unmatch, node->loc);
+					return;
+				}
 			}
 			it1++;
 			it2++;
@@ -568,8 +742,8 @@ void CheckVisitor::visitFunCallNode(FunCallNode *node)
 	}
 	else {
 		if (funcTy.argv != NULL) {
-			errorFlag = true;
-			msgFactory.newError(e_argument_unmatch, node->loc->first_line, node->loc->first_column);
+			hasError = true;
+			msgs.newError(e_argument_unmatch, node->loc);
 			return;
 		}
 	}
@@ -578,64 +752,50 @@ void CheckVisitor::visitFunCallNode(FunCallNode *node)
 
 void CheckVisitor::visitIdVarDefNode(IdVarDefNode *node)
 {
-	if (errorFlag)
+	if (node->isAssigned)
+		visit(node->value);
+
+	if (hasError)
 		return;
 
-	ValueTypeS &vType = node->valueTy;
+	ValueTypeS &vType = types.annotate(node);
 
 	// handle array
 	handleArrayType(&vType);
 
 	// if an assignment exists, check the type
 	if (node->isAssigned) {
-		ValueTypeS &asnTy = node->value->valueTy;
-		if (!typeIsEqual(&vType, &asnTy)) {	// type cast
+		ValueTypeS &asnTy = types.annotate(node->value);
+		if (!typeIsEqual(types, &vType, &asnTy)) {	// type cast
 			asnTy.dstType = vType.type;
 		}
 		if (!asnTy.isComputed && isGlobal) {
-			errorFlag = true;
-			msgFactory.newError(e_global_init_not_constant, node->loc->first_line, node->loc->first_column);
+			hasError = true;
+			msgs.newError(e_global_init_not_constant, node->loc);
 			return;
 		}
-		if (vType.isConstant && asnTy.isComputed) {						// constant propagation
-			node->value = getSimpleNode(asnTy, node->value->loc);
+		if (vType.isConstant && asnTy.isComputed && isAtomType(vType)) {	// constant propagation
 			vType.isComputed = true;
-			vType.constVal = asnTy.constVal;
+			vType.constVal = castConstVal(asnTy.constVal, asnTy.type, vType.type);
 		}
 	}
 	else {
 		if (vType.isConstant) {
-			errorFlag = true;
-			msgFactory.newError(e_const_decl_not_init, node->loc->first_line, node->loc->first_column);
+			hasError = true;
+			msgs.newError(e_const_decl_not_init, node->loc);
 			return;
 		}
 	}
 
-	// global variable
-	if (isGlobal) {
-		if (globalSymTabble.find(*node->name) != globalSymTabble.end()) {
-			errorFlag = true;
-			msgFactory.newError(e_redefinition_of_identifier, node->loc->first_line, node->loc->first_column);
-			return;
-		}
-		globalSymTabble[*node->name] = vType;
-
-	}
-
-	// local variable or struct
-	else {
-		map<string, ValueTypeS> &symTable = *symTableStack[stackPtr-1];
-		if (symTable.find(*(node->name)) != symTable.end()) {
-			errorFlag = true;
-			msgFactory.newError(e_redefinition_of_identifier, node->loc->first_line, node->loc->first_column);
-			return;
-		}
-		symTable[*node->name] = vType;
-
+	// global, local variable or struct member, in the innermost scope
+	if (!symTable.declare(*node->name, vType, node)) {
+		hasError = true;
+		msgs.newError(e_redefinition_of_identifier, node->loc);
+		return;
 	}
 
 	if (debug) {
-		printType(vType);
+		printType(types, vType);
 		printf("  : IdDef\n");
 	}
 }
@@ -643,10 +803,13 @@ void CheckVisitor::visitIdVarDefNode(IdVarDefNode *node)
 
 void CheckVisitor::visitArrayVarDefNode(ArrayVarDefNode *node)
 {
-	if (errorFlag)
+	if (node->isAssigned)
+		visit(node->values);
+
+	if (hasError)
 		return;
 
-	ValueTypeS &vType = node->valueTy;
+	ValueTypeS &vType = types.annotate(node);
 
 	// handle array
 	handleArrayType(&vType);
@@ -657,44 +820,36 @@ void CheckVisitor::visitArrayVarDefNode(ArrayVarDefNode *node)
 		ValueTypeS *atomTy = vType.atom;
 		for (list<Node *>::iterator it = nodes.begin();
 				it != nodes.end(); it++) {
-			if (!typeIsEqual(atomTy, &(*it)->valueTy)) {
-				(*it)->valueTy.dstType = atomTy->type;
+			ValueTypeS &itemTy = types.annotate(*it);
+			if (!typeIsEqual(types, atomTy, &itemTy)) {
+				itemTy.dstType = atomTy->type;
 			}
 		}
 		if (vType.base[0] == 0)
 			vType.base[0] = nodes.size();
-	}
-	else {
-		if (vType.isConstant) {
-			errorFlag = true;
-			msgFactory.newError(e_const_decl_not_init, node->loc->first_line, node->loc->first_column);
+		else if ((int)nodes.size() > vType.base[0]) {
+			hasError = true;
+			msgs.newError(e_excess_initializers, node->loc);
 			return;
 		}
 	}
-
-	// global variable
-	if (isGlobal) {
-		if (globalSymTabble.find(*node->name) != globalSymTabble.end()) {
-			errorFlag = true;
-			msgFactory.newError(e_redefinition_of_identifier, node->loc->first_line, node->loc->first_column);
+	else {
+		if (vType.isConstant) {
+			hasError = true;
+			msgs.newError(e_const_decl_not_init, node->loc);
 			return;
 		}
-		globalSymTabble[*node->name] = vType;
 	}
 
-	// local variable or struct
-	else {
-		map<string, ValueTypeS> &symTable = *symTableStack[stackPtr-1];
-		if (symTable.find(*(node->name)) != symTable.end()) {
-			errorFlag = true;
-			msgFactory.newError(e_redefinition_of_identifier, node->loc->first_line, node->loc->first_column);
-			return;
-		}
-		symTable[*node->name] = vType;
+	// global, local variable or struct member, in the innermost scope
+	if (!symTable.declare(*node->name, vType, node)) {
+		hasError = true;
+		msgs.newError(e_redefinition_of_identifier, node->loc);
+		return;
 	}
 
 	if (debug) {
-		printType(vType);
+		printType(types, vType);
 		printf("  : ArrayDef\n");
 	}
 }
@@ -708,18 +863,26 @@ void CheckVisitor::visitEmptyNode(EmptyNode *node)
 
 void CheckVisitor::visitBlockNode(BlockNode *node)
 {
-	stackPtr--;
-	delete symTableStack[stackPtr];
+	// enter a new scope
+	symTable.enterScope();
+
+	visit(node->blockItems);
+
+	// exit current scope
+	symTable.exitScope();
 }
 
 
 void CheckVisitor::visitVarDeclNode(VarDeclNode *node)
 {
+	visit(node->defList);
+
 	if (node->valueTy.type == STRUCT_TYPE) {
 		string nameStr = *(node->valueTy.structName);
-		if (structTable.find(nameStr) == structTable.end()) {
-			errorFlag = true;
-			msgFactory.newError(e_no_such_struct, node->loc->first_line, node->loc->first_column);
+		map<string, StructLayout>::iterator it = structTable.find(nameStr);
+		if (it == structTable.end() || it->second.loc >= visibleBefore) {
+			hasError = true;
+			msgs.newError(e_no_such_struct, node->loc);
 			return;
 		}
 	}
@@ -728,97 +891,226 @@ void CheckVisitor::visitVarDeclNode(VarDeclNode *node)
 
 void CheckVisitor::visitAssignStmtNode(AssignStmtNode *node)
 {
-	if (errorFlag)
+	visit(node->lval);
+	visit(node->exp);
+
+	if (hasError)
 		return;
 
-	ValueTypeS &lvalTy = node->lval->valueTy;
-	ValueTypeS &expTy = node->exp->valueTy;
+	ValueTypeS &lvalTy = types.annotate(node->lval);
+	ValueTypeS &expTy = types.annotate(node->exp);
 
 	if (lvalTy.isConstant) {
-		errorFlag = true;
-		msgFactory.newError(e_assign_to_constant, node->loc->first_line, node->loc->first_column);
+		hasError = true;
+		msgs.newError(e_assign_to_constant, node->loc);
 		return;
 	}
 
-	if (!typeIsEqual(&lvalTy, &expTy)) {
+	// a compound assignment computes lval op exp like a BinaryExpNode would,
+	// the type it does so in is kept on the statement
+	if (node->op != '=') {
+		if (!isAtomType(lvalTy) || !isAtomType(expTy)) {
+			hasError = true;
+			msgs.newError(e_type_unmatch, node->loc);
+			return;
+		}
+
+		ValueType opType = INT_TYPE;
+		if (lvalTy.type == FLOAT_TYPE || expTy.type == FLOAT_TYPE)
+			opType = FLOAT_TYPE;
+		if (node->op == '%' && opType == FLOAT_TYPE) {
+			hasError = true;
+			msgs.newError(e_float_mod, node->loc);
+			return;
+		}
+
+		types.annotate(node).type = opType;
+		if (expTy.type != opType)
+			expTy.dstType = opType;
+		return;
+	}
+
+	if (!typeIsEqual(types, &lvalTy, &expTy)) {
 		if (isAtomType(lvalTy) && isAtomType(expTy)) {
 			expTy.dstType = lvalTy.type;
 		}
 		else {
-			errorFlag = true;
-			msgFactory.newError(e_type_unmatch, node->loc->first_line, node->loc->first_column);
+			hasError = true;
+			msgs.newError(e_type_unmatch, node->loc);
 			return;
 		}
 	}
-
-	if (expTy.isComputed) {
-		node->exp = getSimpleNode(expTy, node->exp->loc);
-	}
-
 }
 
 
 void CheckVisitor::visitFunCallStmtNode(FunCallStmtNode *node)
 {
-	// empty
+	visit(node->funCall);
 }
 
 
 void CheckVisitor::visitBlockStmtNode(BlockStmtNode *node)
 {
-	// empty
+	visit(node->block);
 }
 
 
 void CheckVisitor::visitCondNode(CondNode *node)
 {
-	// empty
+	if (node->op != NOT_OP)
+		visit(node->lhs);
+	visit(node->rhs);
+
+	if (hasError)
+		return;
+
+	// a condition reads as an int that is 0 or 1
+	ValueTypeS &vType = types.annotate(node);
+	ValueTypeS &rhsTy = types.annotate(node->rhs);
+	vType.type = INT_TYPE;
+	vType.dstType = NO_TYPE;
+	vType.isComputed = false;
+
+	switch (node->op) {
+	case NOT_OP:
+		if (rhsTy.isComputed) {
+			vType.isComputed = true;
+			vType.constVal.ival = !rhsTy.constVal.ival;
+		}
+		return;
+	case AND_OP:
+	case OR_OP:
+	{
+		// once the left side decides, the right side is never evaluated
+		ValueTypeS &lhsTy = types.annotate(node->lhs);
+		if (!lhsTy.isComputed)
+			return;
+		if ((node->op == OR_OP) == (lhsTy.constVal.ival != 0)) {
+			vType.isComputed = true;
+			vType.constVal.ival = lhsTy.constVal.ival;
+		}
+		else if (rhsTy.isComputed) {
+			vType.isComputed = true;
+			vType.constVal.ival = rhsTy.constVal.ival;
+		}
+		return;
+	}
+	default:
+		break;
+	}
+
+	// comparison, atoms are promoted to a common type, pointers compared as is
+	ValueTypeS &lhsTy = types.annotate(node->lhs);
+	if (!isAtomType(lhsTy) || !isAtomType(rhsTy))
+		return;
+	if (lhsTy.type != rhsTy.type)
+		typeUp(&lhsTy, &rhsTy);
+
+	if (lhsTy.isComputed && rhsTy.isComputed) {
+		vType.isComputed = true;
+		vType.constVal.ival = foldCompare(node->op, lhsTy, rhsTy);
+	}
 }
 
 
 void CheckVisitor::visitIfStmtNode(IfStmtNode *node)
 {
-	// empty
+	visit(node->cond);
+	visit(node->then_stmt);
+	if (node->hasElse)
+		visit(node->else_stmt);
 }
 
 
 void CheckVisitor::visitWhileStmtNdoe(WhileStmtNode *node)
 {
-	// empty
+	visit(node->cond);
+	loopDepth++;
+	visit(node->do_stmt);
+	loopDepth--;
 }
 
 
+void CheckVisitor::visitForStmtNode(ForStmtNode *node)
+{
+	if (node->hasInit)
+		visit(node->init);
+	if (node->hasCond)
+		visit(node->cond);
+	loopDepth++;
+	if (node->hasStep)
+		visit(node->step);
+	visit(node->do_stmt);
+	loopDepth--;
+}
+
+
+// the value returned is converted to the return type like the right side
+// of an assignment
 void CheckVisitor::visitReturnStmtNdoe(ReturnStmtNode *node)
 {
-	// empty
+	if (node->hasExp)
+		visit(node->exp);
+
+	if (hasError)
+		return;
+
+	if (!node->hasExp) {
+		if (retType->type != VOID_TYPE) {
+			hasError = true;
+			msgs.newError(e_return_without_value, node->loc);
+		}
+		return;
+	}
+	if (retType->type == VOID_TYPE) {
+		hasError = true;
+		msgs.newError(e_return_value_in_void, node->loc);
+		return;
+	}
+
+	ValueTypeS &expTy = types.annotate(node->exp);
+	if (!typeIsEqual(types, retType, &expTy)) {
+		if (isAtomType(*retType) && isAtomType(expTy))
+			expTy.dstType = retType->type;
+		else {
+			hasError = true;
+			msgs.newError(e_type_unmatch, node->loc);
+		}
+	}
 }
 
 
 void CheckVisitor::visitBreakStmtNode(BreakStmtNode *node)
 {
-	// empty
+	if (loopDepth == 0) {
+		hasError = true;
+		msgs.newError(e_jump_outside_loop, node->loc);
+	}
 }
 
 
 void CheckVisitor::visitContinueStmtNode(ContinueStmtNode *node)
 {
-	// empty
+	if (loopDepth == 0) {
+		hasError = true;
+		msgs.newError(e_jump_outside_loop, node->loc);
+	}
 }
 
 
 void CheckVisitor::visitFuncDeclNode(FuncDeclNode *node)
 {
-	if (errorFlag)
+	if (hasError)
 		return;
 
-	ValueTypeS &vType = node->valueTy;
+	ValueTypeS &vType = types.annotate(node);
 
 	// handle array
 	handleArrayType(&vType);
 
-	if (globalSymTabble.find(*node->name) != globalSymTabble.end()) {
-		errorFlag = true;
-		msgFactory.newError(e_redefinition_of_identifier, node->loc->first_line, node->loc->first_column);
+	if (!symTable.declare(*node->name, vType, node)) {
+		hasError = true;
+		msgs.newError(e_redefinition_of_identifier, node->loc);
 		return;
 	}
 
@@ -827,17 +1119,15 @@ void CheckVisitor::visitFuncDeclNode(FuncDeclNode *node)
 		for (std::list<Node*>::iterator it = nodes.begin();
 				it != nodes.end(); it++) {
 			if ((*it)->valueTy.type == FUNC_TYPE) {
-				errorFlag = true;
-				msgFactory.newError(e_function_arg_cannot_be_functon, node->loc->first_line, node->loc->first_column);
+				hasError = true;
+				msgs.newError(e_function_arg_cannot_be_functon, node->loc);
 			}
 
 		}
 	}
 
-	globalSymTabble[*node->name] = vType;
-
 	if (debug) {
-		printType(vType);
+		printType(types, vType);
 		printf("  : FuncDecl\n");
 	}
 }
@@ -845,71 +1135,234 @@ void CheckVisitor::visitFuncDeclNode(FuncDeclNode *node)
 
 void CheckVisitor::visitFuncDefNode(FuncDefNode *node)
 {
-	isGlobal = true;
-	stackPtr--;
-	delete symTableStack[stackPtr];
+	// the function itself is declared in the enclosing scope
+	visit(node->decl);
+	checkFuncBody(node);
 }
 
 
-void CheckVisitor::visitStructDefNode(StructDefNode *node)
+void CheckVisitor::checkFuncBody(FuncDefNode *node)
 {
-	structTable[*node->name] = symTableStack[stackPtr-1];
-	stackPtr--;
+	// enter the scope of arguments
+	isGlobal = false;
+	retType = types[node->decl].atom;
+	symTable.enterScope();
+
+	// argument types were resolved along with the declaration
+	if (node->decl->hasArgs) {
+		std::list<Node *> nodes = node->decl->valueTy.argv->nodes;
+
+		for (std::list<Node *>::iterator it = nodes.begin();
+				it != nodes.end(); it++) {
+			std::string nameStr = *(dynamic_cast<IdNode*>(*it)->name);
+			symTable.declare(nameStr, types[*it], *it);
+		}
+	}
+
+	visit(node->block);
+
+	// exit the scope of arguments
 	isGlobal = true;
+	symTable.exitScope();
 }
 
 
-void CheckVisitor::visitCompUnitNode(CompUnitNode *node)
+void CheckVisitor::visitStructDefNode(StructDefNode *node)
 {
-	// empty
-}
+	map<string, StructLayout>::iterator old = structTable.find(*node->name);
+	if (old != structTable.end() && old->second.loc != node->loc) {
+		hasError = true;
+		msgs.newError(e_redefinition_of_struct, node->loc);
+		return;
+	}
 
+	// struct members are collected in a scope of their own
+	isGlobal = false;
+	symTable.enterScope();
 
-void CheckVisitor::enterBlockNode(BlockNode *node)
-{
-	symTableStack[stackPtr] = new map<string, ValueTypeS>;
-	stackPtr++;
+	visit(node->decls);
+
+	symTable.exitScope();
+	isGlobal = true;
+
+	// lay the members out in declaration order
+	StructLayout &layout = structTable[*node->name];
+	layout.fields.clear();
+	layout.indexOf.clear();
+	layout.size = 0;
+	layout.align = 1;
+	layout.loc = node->loc;
+
+	for (list<Node *>::iterator it = node->decls->nodes.begin();
+			it != node->decls->nodes.end(); it++) {
+		if ((*it)->type != VAR_DECL_AST)
+			continue;
+		list<Node *> &defs = ((VarDeclNode *)(*it))->defList->nodes;
+		for (list<Node *>::iterator defIt = defs.begin(); defIt != defs.end(); defIt++) {
+			if ((*defIt)->type != ID_VAR_DEF_AST && (*defIt)->type != ARRAY_VAR_DEF_AST)
+				continue;
+
+			FieldLayout field;
+			int align;
+			field.name = *((VarDefNode *)(*defIt))->name;
+			field.vType = types[*defIt];
+			field.index = layout.fields.size();
+			getSizeAlign(field.vType, &field.size, &align);
+
+			field.offset = (layout.size + align - 1) / align * align;
+			layout.size = field.offset + field.size;
+			if (align > layout.align)
+				layout.align = align;
+
+			layout.indexOf[field.name] = field.index;
+			layout.fields.push_back(field);
+		}
+	}
+	layout.size = (layout.size + layout.align - 1) / layout.align * layout.align;
+
+	if (debug) {
+		for (vector<FieldLayout>::iterator it = layout.fields.begin();
+				it != layout.fields.end(); it++) {
+			printType(types, it->vType);
+			printf("  : Field %s, index %d, offset %d, size %d\n",
+					it->name.c_str(), it->index, it->offset, it->size);
+		}
+		printf("struct %s  : StructDef, size %d, align %d\n",
+				node->name->c_str(), layout.size, layout.align);
+	}
 }
 
 
-void CheckVisitor::enterIfStmtNode(IfStmtNode *node)
+// Function bodies only write the slots of their own nodes and only read the
+// globals, so once every global declaration is in, they can be checked side
+// by side.  Each worker runs on a copy of the symbol table and collects its
+// messages apart; they are merged back in source order.  A serial check stays
+// in the error state after the first error, so a worker stops at its first
+// failing body, and nothing after the first one of all is merged.
+struct CheckWorker {
+	const CheckVisitor *parent;
+	MsgFactory msgs;
+	int from, to;
+	int failedAt;
+};
+
+static void *runCheckWorker(void *arg)
 {
-	// epmty
+	CheckWorker *w = (CheckWorker *)arg;
+	CheckVisitor worker(*w->parent, w->msgs);
+
+	w->failedAt = worker.checkFuncBodies(*w->parent, w->from, w->to);
+	return NULL;
 }
 
 
-void CheckVisitor::enterWhileStmtNode(WhileStmtNode *node)
+int CheckVisitor::checkFuncBodies(const CheckVisitor &parent, int from, int to)
 {
-	// empty
+	symTable.rewind(parent.pending[from].height);
+	for (int i = from; i < to; i++) {
+		const PendingBody &body = parent.pending[i];
+
+		// a body starts from the error state after its own declaration,
+		// whatever run it lands in
+		symTable.replay(parent.symTable, body.height);
+		hasError = body.hasError;
+		visibleBefore = body.func->loc;
+		curItem = body.item;
+		inBody = true;
+		checkFuncBody(body.func);
+		if (hasError)
+			return i;
+	}
+	return to;
 }
 
 
-void CheckVisitor::enterFuncDefNode(FuncDefNode *node)
+void CheckVisitor::visitCompUnitNode(CompUnitNode *node)
 {
-	isGlobal = false;
-	symTableStack[stackPtr] = new map<string, ValueTypeS>;
-	stackPtr++;
-	map<string, ValueTypeS> &symTable = *symTableStack[stackPtr-1];
-
+	// -t prints types as they are checked, keep that in source order
+	if (debug) {
+		for (list<Node *>::iterator it = node->nodes.begin();
+				it != node->nodes.end(); it++) {
+			visit(*it);
+		}
+		return;
+	}
 
-	if (node->decl->hasArgs) {
-		std::list<Node *> nodes = node->decl->valueTy.argv->nodes;
+	// declarations first, in order
+	pending.clear();
+	for (list<Node *>::iterator it = node->nodes.begin();
+			it != node->nodes.end(); it++) {
+		curItem = deps != NULL ? deps->itemOf(*it) : -1;
+		inBody = false;
 
-		for (std::list<Node *>::iterator it = nodes.begin();
-				it != nodes.end(); it++) {
-			std::string nameStr = *(dynamic_cast<IdNode*>(*it)->name);
-			handleArrayType(&(*it)->valueTy);
-			symTable[nameStr] = (*it)->valueTy;
+		if ((*it)->type != FUNC_DEF_AST) {
+			visit(*it);
+			continue;
 		}
-	}
-}
 
+		FuncDefNode *func = (FuncDefNode *)(*it);
+		visit(func->decl);
+
+		// an unchanged body is not looked at again
+		if (deps != NULL && deps->reusable(func))
+			continue;
+
+		PendingBody body;
+		body.func = func;
+		body.item = curItem;
+		body.height = symTable.height();
+		body.hasError = hasError;
+		body.nErrors = msgs.errorCount();
+		body.nWarnings = msgs.warningCount();
+		pending.push_back(body);
+	}
+	curItem = -1;
 
-void CheckVisitor::enterStructDefNode(StructDefNode *node)
-{
-	isGlobal = false;
-	symTableStack[stackPtr] = new map<string, ValueTypeS>;
-	stackPtr++;
-}
+	if (pending.empty())
+		return;
 
+	// then the bodies, in contiguous runs, one per processor
+	int nFuncs = pending.size();
+	long nProcs = sysconf(_SC_NPROCESSORS_ONLN);
+	int nThreads = nProcs < 1 ? 1 : nProcs;
+	if (nThreads > nFuncs)
+		nThreads = nFuncs;
+
+	vector<CheckWorker> workers(nThreads);
+	vector<pthread_t> threads(nThreads);
+	vector<bool> started(nThreads, false);
+	for (int i = 0; i < nThreads; i++) {
+		workers[i].parent = this;
+		workers[i].from = (long)nFuncs * i / nThreads;
+		workers[i].to = (long)nFuncs * (i + 1) / nThreads;
+		workers[i].failedAt = workers[i].to;
+	}
 
+	// the first run goes on this thread, the rest on new ones, falling
+	// back to this thread if one can't be created
+	for (int i = 1; i < nThreads; i++)
+		started[i] = pthread_create(&threads[i], NULL,
+				runCheckWorker, &workers[i]) == 0;
+	for (int i = 0; i < nThreads; i++)
+		if (!started[i])
+			runCheckWorker(&workers[i]);
+
+	for (int i = 0; i < nThreads; i++)
+		if (started[i])
+			pthread_join(threads[i], NULL);
+
+	// up to the first failing body, with the declarations above it
+	int nMerged = nThreads;
+	for (int i = 0; i < nThreads; i++) {
+		if (workers[i].failedAt < workers[i].to) {
+			const PendingBody &body = pending[workers[i].failedAt];
+			msgs.truncate(body.nErrors, body.nWarnings);
+			hasError = true;
+			nMerged = i + 1;
+			break;
+		}
+	}
+	for (int i = 0; i < nMerged; i++)
+		msgs.merge(workers[i].msgs);
+	pending.clear();
+}
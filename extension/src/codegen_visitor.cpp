@@ -2,6 +2,8 @@
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/PassManager.h"
@@ -12,6 +14,8 @@
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
 
 #include <cctype>
 #include <cstdio>
@@ -38,10 +42,10 @@ static ValueTypeS getArrayItemType(ValueTypeS arrayTy)
 	if (arrayTy.dim == 1)
 		vType = *(arrayTy.atom);
 	else {
+		// drop the outermost bound without touching the shared base array
 		vType = arrayTy;
 		vType.dim--;
-		for (int i = 0; i < vType.dim ; i++)
-			vType.base[i] = vType.base[i+1];
+		vType.base++;
 	}
 
 	return vType;
@@ -56,11 +60,70 @@ static GlobalVariable::LinkageTypes getLinkageTyp(ValueTypeS vType)
 }
 
 
-static Type *getLLVMVarType(ValueTypeS vType)
+// The kind of type and, for the kinds that have them, the struct name, the
+// array bounds and the keys of the atom and of the argument types; scalar
+// types differ by kind only.
+CodegenVisitor::TypeKey::TypeKey(const ValueTypeS &vType, const TypeTable &types)
+	: type(vType.type)
+{
+	switch (type) {
+	case STRUCT_TYPE:
+		structName = *vType.structName;
+		break;
+	case PTR_TYPE:
+		parts.push_back(TypeKey(*vType.atom, types));
+		break;
+	case ARRAY_TYPE:
+		bounds.assign(vType.base, vType.base + vType.dim);
+		parts.push_back(TypeKey(*vType.atom, types));
+		break;
+	case FUNC_TYPE:
+		parts.push_back(TypeKey(*vType.atom, types));
+		if (vType.argv != NULL) {
+			std::list<Node *> &nodes = vType.argv->nodes;
+			for (std::list<Node *>::iterator it = nodes.begin(); it != nodes.end(); ++it)
+				parts.push_back(TypeKey(types[*it], types));
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+bool CodegenVisitor::TypeKey::operator<(const TypeKey &other) const
+{
+	if (type != other.type)
+		return type < other.type;
+	if (bounds != other.bounds)
+		return bounds < other.bounds;
+	if (structName != other.structName)
+		return structName < other.structName;
+	return parts < other.parts;
+}
+
+
+// every type is lowered once, the parts of arrays, pointers and function
+// types through here as well
+Type *CodegenVisitor::getLLVMVarType(const ValueTypeS &vType)
+{
+	TypeKey key(vType, types);
+	std::map<TypeKey, Type *>::iterator it = typeCache.find(key);
+	if (it != typeCache.end())
+		return it->second;
+
+	// a struct used before its definition is not there yet, try again later
+	Type *type = lowerType(vType);
+	if (type != 0)
+		typeCache[key] = type;
+	return type;
+}
+
+
+Type *CodegenVisitor::lowerType(const ValueTypeS &vType)
 {
 	switch (vType.type) {
 	case NO_TYPE:
-		return nullptr;
+		return 0;
 	case INT_TYPE:
 		return Type::getInt32Ty(getGlobalContext());
 	case FLOAT_TYPE:
@@ -70,7 +133,10 @@ static Type *getLLVMVarType(ValueTypeS vType)
 	case VOID_TYPE:
 		return Type::getVoidTy(getGlobalContext());
 	case STRUCT_TYPE:
-		return TheModule->getTypeByName(*vType.structName);
+	{
+		std::map<std::string, StructType *>::iterator it = structTypes.find(*vType.structName);
+		return it == structTypes.end() ? 0 : it->second;
+	}
 	case PTR_TYPE:
 		return PointerType::get(getLLVMVarType(*vType.atom), 0);
 	case ARRAY_TYPE:
@@ -80,25 +146,188 @@ static Type *getLLVMVarType(ValueTypeS vType)
 	}
 	case FUNC_TYPE:
 		{
-		std::vector<Type *> types;
+		// structs as classifyCall says: the address of a result in memory
+		// (sret) comes first, a struct argument in memory is passed by its
+		// address (byval), one in registers as one argument per register
+		const ABIInfo &abi = classifyCall(vType);
+		std::vector<Type *> argTypes;
+		Type *retType = getLLVMVarType(*vType.atom);
+		if (abi.ret.kind == ABIArg::INDIRECT) {
+			argTypes.push_back(PointerType::get(retType, 0));
+			retType = Type::getVoidTy(getGlobalContext());
+		}
+		else if (abi.ret.kind == ABIArg::COERCED)
+			retType = getCoercedType(abi.ret);
 		if (vType.argv != NULL) {
 			std::list<Node *> nodes = vType.argv->nodes;
+			int i = 0;
 			for (std::list<Node *>::iterator it = nodes.begin();
-					it != nodes.end(); ++it) {
-				Type *argType = getLLVMVarType((*it)->valueTy);
+					it != nodes.end(); ++it, ++i) {
+				const ABIArg &arg = abi.args[i];
+				Type *argType = getLLVMVarType(types[*it]);
+				if (arg.kind == ABIArg::COERCED) {
+					for (int part = 0; part < arg.nParts; part++)
+						argTypes.push_back(arg.parts[part]);
+					continue;
+				}
 				if (argType->isArrayTy() || argType->isStructTy())
 					argType = PointerType::get(argType, 0);
-				types.push_back(argType);
+				argTypes.push_back(argType);
 			}
 		}
-		return FunctionType::get(getLLVMVarType(*vType.atom), types, false);
+		return FunctionType::get(retType, argTypes, false);
 		}	// end case
 	default:
-		return nullptr;
+		return 0;
 	}
 }
 
 
+// Marks the eightbytes of a struct that hold anything but floats, they go
+// in general registers; those with floats only go in SSE registers.
+static void markIntegerEightbytes(const DataLayout &layout, Type *type, uint64_t offset, bool isInt[2])
+{
+	if (StructType *structTy = dyn_cast<StructType>(type)) {
+		const StructLayout *structLayout = layout.getStructLayout(structTy);
+		for (unsigned i = 0; i < structTy->getNumElements(); i++)
+			markIntegerEightbytes(layout, structTy->getElementType(i),
+					offset + structLayout->getElementOffset(i), isInt);
+	}
+	else if (ArrayType *arrayTy = dyn_cast<ArrayType>(type)) {
+		uint64_t itemSize = layout.getTypeAllocSize(arrayTy->getElementType());
+		for (uint64_t i = 0; i < arrayTy->getNumElements(); i++)
+			markIntegerEightbytes(layout, arrayTy->getElementType(), offset + i * itemSize, isInt);
+	}
+	else if (!type->isFloatTy())
+		isInt[offset / 8] = true;
+}
+
+// The registers a struct of at most 16 bytes is passed in, false if it
+// goes in memory.  An INTEGER eightbyte is an integer as wide as the bytes
+// of the struct in it, an SSE one a float or a double; *nInt and *nSSE are
+// set to how many registers of each kind it takes.
+bool CodegenVisitor::classifyStruct(Type *type, ABIArg *abi, int *nInt, int *nSSE)
+{
+	StructType *structTy = cast<StructType>(type);
+	if (structTy->isOpaque())
+		return false;
+
+	DataLayout layout(TheModule);
+	uint64_t size = layout.getTypeAllocSize(structTy);
+	if (size == 0 || size > 16)
+		return false;
+
+	bool isInt[2] = {false, false};
+	markIntegerEightbytes(layout, structTy, 0, isInt);
+
+	abi->kind = ABIArg::COERCED;
+	abi->nParts = (size + 7) / 8;
+	*nInt = 0;
+	*nSSE = 0;
+	for (int i = 0; i < abi->nParts; i++) {
+		uint64_t bytes = size - 8 * i < 8 ? size - 8 * i : 8;
+		if (isInt[i]) {
+			abi->parts[i] = IntegerType::get(getGlobalContext(), bytes * 8);
+			(*nInt)++;
+		}
+		else {
+			if (bytes == 4)
+				abi->parts[i] = Type::getFloatTy(getGlobalContext());
+			else
+				abi->parts[i] = Type::getDoubleTy(getGlobalContext());
+			(*nSSE)++;
+		}
+	}
+	return true;
+}
+
+// Arguments take the six general and eight SSE registers in order; a struct
+// that does not fit in what is left goes in memory as a whole.
+const CodegenVisitor::ABIInfo &CodegenVisitor::classifyCall(const ValueTypeS &funcTy)
+{
+	TypeKey key(funcTy, types);
+	std::map<TypeKey, ABIInfo>::iterator it = abiCache.find(key);
+	if (it != abiCache.end())
+		return it->second;
+
+	ABIInfo info;
+	int freeInt = 6, freeSSE = 8;
+	int nInt, nSSE;
+
+	Type *retType = getLLVMVarType(*funcTy.atom);
+	info.ret.kind = ABIArg::DIRECT;
+	info.ret.nParts = 0;
+	if (retType->isStructTy() && !classifyStruct(retType, &info.ret, &nInt, &nSSE)) {
+		info.ret.kind = ABIArg::INDIRECT;
+		freeInt--;		// for the address of the result
+	}
+
+	if (funcTy.argv != NULL) {
+		std::list<Node *> &nodes = funcTy.argv->nodes;
+		for (std::list<Node *>::iterator argIt = nodes.begin(); argIt != nodes.end(); argIt++) {
+			ABIArg arg;
+			arg.kind = ABIArg::DIRECT;
+			arg.nParts = 0;
+			Type *argType = getLLVMVarType(types[*argIt]);
+			if (argType->isStructTy()) {
+				if (classifyStruct(argType, &arg, &nInt, &nSSE)
+						&& nInt <= freeInt && nSSE <= freeSSE) {
+					freeInt -= nInt;
+					freeSSE -= nSSE;
+				}
+				else
+					arg.kind = ABIArg::INDIRECT;
+			}
+			else if (argType->isFloatTy())
+				freeSSE--;
+			else
+				freeInt--;
+			info.args.push_back(arg);
+		}
+	}
+
+	return abiCache[key] = info;
+}
+
+Type *CodegenVisitor::getCoercedType(const ABIArg &abi)
+{
+	if (abi.nParts == 1)
+		return abi.parts[0];
+	return StructType::get(getGlobalContext(), ArrayRef<Type *>(abi.parts, abi.nParts));
+}
+
+// A struct is moved to and from the registers it is passed in through a
+// temporary of the registers' types, which may be larger than the struct,
+// so only the bytes of the struct are copied.
+Value *CodegenVisitor::createCoerced(const ABIArg &abi)
+{
+	Function *currentFunc = Builder.GetInsertBlock()->getParent();
+	IRBuilder<> TmpBuilder(&currentFunc->getEntryBlock(), currentFunc->getEntryBlock().begin());
+	return TmpBuilder.CreateAlloca(getCoercedType(abi), 0, "coerce");
+}
+
+Value *CodegenVisitor::coerceFrom(const ABIArg &abi, Value *structPtr)
+{
+	Value *coerced = createCoerced(abi);
+	Type *structType = cast<PointerType>(structPtr->getType())->getElementType();
+	Builder.CreateMemCpy(coerced, structPtr, ConstantExpr::getSizeOf(structType), 1);
+	return coerced;
+}
+
+void CodegenVisitor::coerceTo(Value *coerced, Value *structPtr)
+{
+	Type *structType = cast<PointerType>(structPtr->getType())->getElementType();
+	Builder.CreateMemCpy(structPtr, coerced, ConstantExpr::getSizeOf(structType), 1);
+}
+
+Value *CodegenVisitor::getCoercedPart(const ABIArg &abi, Value *coerced, int part)
+{
+	if (abi.nParts == 1)
+		return coerced;
+	return Builder.CreateStructGEP(coerced, part);
+}
+
+
 static Value *typeCast(ValueTypeS vType, Value *v)
 {
 	switch (vType.type) {
@@ -128,267 +357,428 @@ static Value *typeCast(ValueTypeS vType, Value *v)
 }
 
 
-Value *CodegenVisitor::lookUp(std::string nameStr)
+// *dst = *src for the struct both point to
+static void createStructCopy(Value *dst, Value *src)
 {
-	Value *retV = nullptr;
-	int sp = StackPtr;
-	while (sp > 0) {
-		std::map<std::string, AllocaInst *> &ConstLocalVariables = *ConstLocalTableStack[sp-1];
-		std::map<std::string, AllocaInst *> &LocalVariables = *LocalTableStack[sp-1];
-		if (ConstLocalVariables.find(nameStr) != ConstLocalVariables.end()) {
-			retV = ConstLocalVariables[nameStr];
-			break;
-		}
-		else if (LocalVariables.find(nameStr) != LocalVariables.end()) {
-			retV = LocalVariables[nameStr];
-			break;
-		}
-		else {
-			retV = nullptr;
-			sp--;
+	Type *structType = cast<PointerType>(dst->getType())->getElementType();
+	Builder.CreateMemCpy(dst, src, ConstantExpr::getSizeOf(structType), 1);
+}
+
+
+// lhs op rhs, both already of type; signed overflow is undefined, so int
+// arithmetic is nsw
+static Value *createArith(char op, ValueType type, Value *lhs, Value *rhs)
+{
+	if (type == INT_TYPE) {
+		switch (op) {
+		case '+':
+			return Builder.CreateNSWAdd(lhs, rhs, "addtmp");
+		case '-':
+			return Builder.CreateNSWSub(lhs, rhs, "subtmp");
+		case '*':
+			return Builder.CreateNSWMul(lhs, rhs, "multmp");
+		case '/':
+			return Builder.CreateSDiv(lhs, rhs, "divtmp");
+		case '%':
+			return Builder.CreateSRem(lhs, rhs, "modtmp");
+		default:
+			return 0;
 		}
 	}
-	if (retV == nullptr) {
-		if (GloblalVariables.find(nameStr) != GloblalVariables.end()) {
-			retV = GloblalVariables[nameStr];
-		}
-		else
+	else {
+		switch (op) {
+		case '+':
+			return Builder.CreateFAdd(lhs, rhs, "addtmp");
+		case '-':
+			return Builder.CreateFSub(lhs, rhs, "subtmp");
+		case '*':
+			return Builder.CreateFMul(lhs, rhs, "multmp");
+		case '/':
+			return Builder.CreateFDiv(lhs, rhs, "divtmp");
+		default:
 			return 0;
+		}
 	}
-	return retV;
 }
 
-std::vector<Value *> CodegenVisitor::getValuesFromStack(int size)
+
+// Types of the language that cannot alias each other: int, float and
+// pointers, all below char, which may alias anything.  A struct lists the
+// type node and offset of each member, an array is described by its items.
+MDNode *CodegenVisitor::getTBAATypeNode(Type *type)
 {
-	std::vector<Value *> v(size);
-	for (int i = 0; i < size; i++) {
-		v[size-1-i] = pending.back();
-		pending.pop_back();
+	std::map<Type *, MDNode *>::iterator it = tbaaTypes.find(type);
+	if (it != tbaaTypes.end())
+		return it->second;
+
+	MDBuilder MDB(getGlobalContext());
+	MDNode *charNode = MDB.createTBAAScalarTypeNode("omnipotent char", MDB.createTBAARoot("C1 TBAA"));
+	MDNode *typeNode = 0;
+	if (type->isIntegerTy(8))
+		typeNode = charNode;
+	else if (type->isIntegerTy(32))
+		typeNode = MDB.createTBAAScalarTypeNode("int", charNode);
+	else if (type->isFloatTy())
+		typeNode = MDB.createTBAAScalarTypeNode("float", charNode);
+	else if (type->isPointerTy())
+		typeNode = MDB.createTBAAScalarTypeNode("any pointer", charNode);
+	else if (ArrayType *arrayTy = dyn_cast<ArrayType>(type))
+		typeNode = getTBAATypeNode(arrayTy->getElementType());
+	else if (StructType *structTy = dyn_cast<StructType>(type)) {
+		if (structTy->hasName()) {
+			DataLayout layout(TheModule);
+			const StructLayout *structLayout = layout.getStructLayout(structTy);
+			std::vector<std::pair<MDNode *, uint64_t> > fields;
+			for (unsigned i = 0; i < structTy->getNumElements(); i++) {
+				MDNode *fieldNode = getTBAATypeNode(structTy->getElementType(i));
+				if (fieldNode != 0)
+					fields.push_back(std::make_pair(fieldNode, structLayout->getElementOffset(i)));
+			}
+			typeNode = MDB.createTBAAStructTypeNode(structTy->getName(), fields);
+		}
 	}
-	return v;
+
+	tbaaTypes[type] = typeNode;
+	return typeNode;
 }
 
-// initialization
-CodegenVisitor::CodegenVisitor(std::string output_filename)
+MDNode *CodegenVisitor::getTBAATag(Type *type)
 {
-	StackPtr = 0;
-	orderChanged = true;
+	std::map<Type *, MDNode *>::iterator it = tbaaTags.find(type);
+	if (it != tbaaTags.end())
+		return it->second;
+
+	MDNode *typeNode = type->isAggregateType() ? 0 : getTBAATypeNode(type);
+	MDNode *tag = 0;
+	if (typeNode != 0)
+		tag = MDBuilder(getGlobalContext()).createTBAAStructTagNode(typeNode, typeNode, 0);
+	tbaaTags[type] = tag;
+	return tag;
 }
 
+// (struct, member type, offset), so members of one struct are told apart
+// even when they have the same type
+MDNode *CodegenVisitor::getTBAAFieldTag(StructType *type, unsigned field)
+{
+	std::pair<Type *, unsigned> key(type, field);
+	std::map<std::pair<Type *, unsigned>, MDNode *>::iterator it = tbaaFieldTags.find(key);
+	if (it != tbaaFieldTags.end())
+		return it->second;
+
+	Type *fieldTy = type->getElementType(field);
+	MDNode *baseNode = getTBAATypeNode(type);
+	MDNode *accessNode = fieldTy->isAggregateType() ? 0 : getTBAATypeNode(fieldTy);
+	MDNode *tag = 0;
+	if (baseNode != 0 && accessNode != 0) {
+		DataLayout layout(TheModule);
+		uint64_t offset = layout.getStructLayout(type)->getElementOffset(field);
+		tag = MDBuilder(getGlobalContext()).createTBAAStructTagNode(baseNode, accessNode, offset);
+	}
+	tbaaFieldTags[key] = tag;
+	return tag;
+}
 
-CodegenVisitor::~CodegenVisitor()
+LoadInst *CodegenVisitor::createLoad(Value *ptr, const std::string &name, MDNode *tag)
 {
+	LoadInst *load = Builder.CreateLoad(ptr, name);
+	if (tag == 0)
+		tag = getTBAATag(load->getType());
+	if (tag != 0)
+		load->setMetadata(LLVMContext::MD_tbaa, tag);
+	return load;
 }
 
-void CodegenVisitor::dump()
+void CodegenVisitor::createStore(Value *v, Value *ptr, MDNode *tag)
 {
-	TheModule->dump();
+	StoreInst *store = Builder.CreateStore(v, ptr);
+	if (tag == 0)
+		tag = getTBAATag(v->getType());
+	if (tag != 0)
+		store->setMetadata(LLVMContext::MD_tbaa, tag);
 }
 
 
-void CodegenVisitor::visitNodeList(NodeList *node)
+// the variable or function the checker bound this identifier to
+Value *CodegenVisitor::lookUp(IdNode *node)
 {
+	const Node *decl = types.declOf(node);
+	if (decl == NULL)
+		return 0;
+
+	// a local constant has no storage until its address is taken
+	const ValueTypeS &declTy = types[decl];
+	if (values[decl->id] == 0 && declTy.isComputed) {
+		values[decl->id] = new GlobalVariable(*TheModule, getLLVMVarType(declTy),
+				true, GlobalValue::PrivateLinkage,
+				(Constant *)getConstant(declTy), *node->name);
+	}
+	return values[decl->id];
 }
 
+// address of a struct member, the checker already resolved which one; *tag
+// is set to the TBAA tag for accessing it
+Value *CodegenVisitor::getStructItemPtr(StructItemNode *node, MDNode **tag)
+{
+	Value *structPtr = visit(node->stru);
+	int field = types.fieldOf(node);
+	if (tag != 0)
+		*tag = getTBAAFieldTag(cast<StructType>(structPtr->getType()->getPointerElementType()), field);
+	return Builder.CreateStructGEP(structPtr, field, "struct_item");
+}
 
-void CodegenVisitor::visitNumNode(NumNode *node)
+// address of an array item.  Indexing stays inside the array, so the GEP is
+// inbounds; indices are int or char, both signed, and are sign extended to
+// the pointer width
+Value *CodegenVisitor::getArrayItemPtr(ArrayItemNode *node)
 {
-	Value *v = ConstantInt::get(getGlobalContext(), APInt(32, node->val, true));
-	ValueTypeS vType = node->valueTy;
-	if (vType.dstType != NO_TYPE && vType.dstType != vType.type) {
-		if (vType.dstType == FLOAT_TYPE)		// int to float
-			v = Builder.CreateCast(Instruction::SIToFP, v, Type::getFloatTy(getGlobalContext()));
-		else									// int to char
-			v = Builder.CreateCast(Instruction::Trunc, v, Type::getInt8Ty(getGlobalContext()));
-	}
-	pending.insert(pending.end(), v);
+	Value *arrayPtr = visit(node->array);
+	vector<Value*> indexVs = getValuesFromList(node->index);
+
+	std::vector<Value *> idxList;
+	idxList.push_back(ConstantInt::get(getGlobalContext(), APInt(32, 0, true)));
+	for (vector<Value*>::iterator it = indexVs.begin(); it != indexVs.end(); it++)
+		idxList.push_back(Builder.CreateSExt(*it, Type::getInt64Ty(getGlobalContext()), "idxext"));
+
+	return Builder.CreateInBoundsGEP(arrayPtr, idxList, "array_ptr");
 }
 
+std::vector<Value *> CodegenVisitor::getValuesFromList(NodeList *list)
+{
+	std::vector<Value *> v;
+	for (std::list<Node *>::iterator it = list->nodes.begin();
+			it != list->nodes.end(); it++) {
+		v.push_back(visit(*it));
+	}
+	return v;
+}
 
-void CodegenVisitor::visitFNumNode(FNumNode *node)
+// emit the constant the checker folded an expression to
+Value *CodegenVisitor::getConstant(const ValueTypeS &vType)
 {
-	Value *v = ConstantFP::get(getGlobalContext(), APFloat((float)node->fval));
-	ValueTypeS vType = node->valueTy;
-	if (vType.dstType != NO_TYPE && vType.dstType != vType.type) {
-		if (vType.dstType == INT_TYPE)		// float to int
-			v = Builder.CreateCast(Instruction::FPToSI, v, Type::getInt32Ty(getGlobalContext()));
-		else								// float to char
-			v = Builder.CreateCast(Instruction::FPToSI, v, Type::getInt8Ty(getGlobalContext()));
+	// the implicit cast is folded as well
+	ValueType type = vType.dstType != NO_TYPE ? vType.dstType : vType.type;
+	ConstVal val = castConstVal(vType.constVal, vType.type, type);
+
+	switch (type) {
+	case INT_TYPE:
+		return ConstantInt::get(getGlobalContext(), APInt(32, val.ival, true));
+	case FLOAT_TYPE:
+		return ConstantFP::get(getGlobalContext(), APFloat((float)val.fval));
+	case CHAR_TYPE:
+		return ConstantInt::get(getGlobalContext(), APInt(8, (int)val.cval, true));
+	default:
+		return 0;
 	}
-	pending.insert(pending.end(), v);
+}
+
+// initialization
+CodegenVisitor::CodegenVisitor(std::string output_filename, const TypeTable &types)
+	: types(types), values(nodeIdBound(), (Value *)0), loopCount(0),
+	  deps(0), prevModule(0), effects(0)
+{
 }
 
 
-void CodegenVisitor::visitCharNode(CharNode *node)
+void CodegenVisitor::reuseBodies(const DepGraph *deps, Module *prev)
 {
-	Value *v = ConstantInt::get(getGlobalContext(), APInt(8, (int)(node->cval), true));
-	ValueTypeS vType = node->valueTy;
-	if (vType.dstType != NO_TYPE && vType.dstType != vType.type) {
-		if (vType.dstType == INT_TYPE)		// char to int
-			v = Builder.CreateCast(Instruction::SExt, v, Type::getInt32Ty(getGlobalContext()));
-		else								// char to float
-			v = Builder.CreateCast(Instruction::SIToFP, v, Type::getFloatTy(getGlobalContext()));
-	}
-	pending.insert(pending.end(), v);
+	this->deps = deps;
+	prevModule = prev;
 }
 
 
-void CodegenVisitor::visitBinaryExpNode(BinaryExpNode *node)
+void CodegenVisitor::setEffects(const EffectVisitor *effects)
 {
-	Value *rValue = pending.back();
-	pending.pop_back();
-	Value *lValue = pending.back();
-	pending.pop_back();
+	this->effects = effects;
+}
 
-	if (lValue == 0 || rValue == 0) {
-		pending.insert(pending.end(), 0);
-		return;
+
+// Maps what a body taken from the previous module refers to onto this one:
+// globals and functions by name, struct types by name (they were renamed to
+// "prev.<name>" when the previous module was read, and LLVM may have added a
+// ".<n>" of its own), and private constants are copied over the first time a
+// body uses them.
+class PrevModuleMapper : public ValueMapTypeRemapper, public ValueMaterializer {
+public:
+	PrevModuleMapper(const std::map<std::string, StructType *> &structTypes)
+		: structTypes(structTypes)
+	{
 	}
 
-	Value *v;
-	ValueTypeS vType = node->valueTy;
-	if (vType.type == INT_TYPE) {
-		switch (node->op) {
-		case '+':
-			v = Builder.CreateAdd(lValue, rValue, "addtmp");
-			break;
-		case '-':
-			v = Builder.CreateSub(lValue, rValue, "subtmp");
-			break;
-		case '*':
-			v = Builder.CreateMul(lValue, rValue, "multmp");
-			break;
-		case '/':
-			v = Builder.CreateSDiv(lValue, rValue, "divtmp");
-			break;
-		case '%':
-			v = Builder.CreateSRem(lValue, rValue, "modtmp");
-			break;
-		default:
-			v = 0;
-			break;
+	Type *remapType(Type *srcTy)
+	{
+		if (StructType *st = dyn_cast<StructType>(srcTy)) {
+			if (st->hasName() && st->getName().startswith("prev.")) {
+				std::string name = st->getName().substr(5).str();
+				std::map<std::string, StructType *>::const_iterator it =
+						structTypes.find(name.substr(0, name.find('.')));
+				return it == structTypes.end() ? 0 : it->second;
+			}
+			return st;
+		}
+		if (PointerType *pt = dyn_cast<PointerType>(srcTy))
+			return PointerType::get(remapType(pt->getElementType()), pt->getAddressSpace());
+		if (ArrayType *at = dyn_cast<ArrayType>(srcTy))
+			return ArrayType::get(remapType(at->getElementType()), at->getNumElements());
+		if (FunctionType *ft = dyn_cast<FunctionType>(srcTy)) {
+			std::vector<Type *> params;
+			for (unsigned i = 0; i < ft->getNumParams(); i++)
+				params.push_back(remapType(ft->getParamType(i)));
+			return FunctionType::get(remapType(ft->getReturnType()), params, ft->isVarArg());
 		}
+		return srcTy;
 	}
-	else {
-		switch (node->op) {
-		case '+':
-			v = Builder.CreateFAdd(lValue, rValue, "addtmp");
-			break;
-		case '-':
-			v = Builder.CreateFSub(lValue, rValue, "subtmp");
-			break;
-		case '*':
-			v = Builder.CreateFMul(lValue, rValue, "multmp");
-			break;
-		case '/':
-			v = Builder.CreateFDiv(lValue, rValue, "divtmp");
-			break;
-		default:
-			v = 0;
-			break;
+
+	Value *materializeValueFor(Value *v)
+	{
+		GlobalValue *g = dyn_cast<GlobalValue>(v);
+		if (g == 0)
+			return 0;
+
+		GlobalVariable *gVar = dyn_cast<GlobalVariable>(g);
+		if (gVar != 0 && gVar->hasPrivateLinkage()) {
+			GlobalVariable *copy = new GlobalVariable(*TheModule,
+					remapType(gVar->getType()->getElementType()), gVar->isConstant(),
+					GlobalValue::PrivateLinkage, 0, gVar->getName());
+			if (gVar->hasInitializer())
+				copy->setInitializer(MapValue(gVar->getInitializer(), vmap, RF_None, this, this));
+			return copy;
+		}
+
+		if (GlobalValue *mine = TheModule->getNamedValue(g->getName()))
+			return mine;
+
+		// only intrinsics should be missing, declare them here too
+		if (Function *f = dyn_cast<Function>(g)) {
+			Function *decl = Function::Create(cast<FunctionType>(remapType(f->getFunctionType())),
+					f->getLinkage(), f->getName(), TheModule);
+			decl->setAttributes(f->getAttributes());
+			return decl;
 		}
+		return 0;
 	}
 
+	ValueToValueMapTy vmap;
+
+private:
+	const std::map<std::string, StructType *> &structTypes;
+};
+
+
+void CodegenVisitor::cloneReusedBodies()
+{
+	PrevModuleMapper mapper(structTypes);
+
+	for (std::vector<Function *>::iterator it = reused.begin(); it != reused.end(); it++) {
+		Function *F = *it;
+		Function *oldF = prevModule->getFunction(F->getName());
+
+		Function::arg_iterator argIt = F->arg_begin();
+		for (Function::arg_iterator oldIt = oldF->arg_begin(); oldIt != oldF->arg_end(); oldIt++, argIt++) {
+			argIt->setName(oldIt->getName());
+			mapper.vmap[&*oldIt] = &*argIt;
+		}
+
+		// the old attributes would come along, but what the callees do
+		// may have changed since
+		AttributeSet attrs = F->getAttributes();
+		SmallVector<ReturnInst *, 4> returns;
+		CloneFunctionInto(F, oldF, mapper.vmap, true, returns, "", 0, &mapper, &mapper);
+		F->setAttributes(attrs);
+	}
+	reused.clear();
+}
+
+
+CodegenVisitor::~CodegenVisitor()
+{
+}
+
+void CodegenVisitor::dump()
+{
+	TheModule->dump();
+}
+
+
+Value *CodegenVisitor::visitNodeList(NodeList *node)
+{
+	for (std::list<Node *>::iterator it = node->nodes.begin();
+			it != node->nodes.end(); it++) {
+		visit(*it);
+	}
+	return 0;
+}
+
+
+Value *CodegenVisitor::visitNumNode(NumNode *node)
+{
+	return getConstant(types[node]);
+}
+
+
+Value *CodegenVisitor::visitFNumNode(FNumNode *node)
+{
+	return getConstant(types[node]);
+}
+
+
+Value *CodegenVisitor::visitCharNode(CharNode *node)
+{
+	return getConstant(types[node]);
+}
+
+
+Value *CodegenVisitor::visitBinaryExpNode(BinaryExpNode *node)
+{
+	ValueTypeS vType = types[node];
+	if (vType.isComputed)
+		return getConstant(vType);
+
+	Value *lValue = visit(node->lhs);
+	Value *rValue = visit(node->rhs);
+
+	if (lValue == 0 || rValue == 0)
+		return 0;
+
+	Value *v = createArith(node->op, vType.type, lValue, rValue);
+
 	// type cast
 	if (vType.dstType != NO_TYPE && vType.dstType != vType.type) {
 		v = typeCast(vType, v);
 	}
 
-	pending.insert(pending.end(), v);
+	return v;
 }
 
 
-void CodegenVisitor::visitUnaryExpNode(UnaryExpNode *node)
+Value *CodegenVisitor::visitUnaryExpNode(UnaryExpNode *node)
 {
+	ValueTypeS vType = types[node];
+	if (vType.isComputed)
+		return getConstant(vType);
+
 	Value *operandV;
 	Value *retV;
 
 	switch (node->op) {
 	case '+':
-		node->operand->accept(*this);
-		operandV = pending.back();
-		pending.pop_back();
+		operandV = visit(node->operand);
 		retV = operandV;
 		break;
 	case '-':
-		node->operand->accept(*this);
-		operandV = pending.back();
-		pending.pop_back();
-		retV = Builder.CreateNeg(operandV, "negtmp");
+		operandV = visit(node->operand);
+		if (vType.type == FLOAT_TYPE)
+			retV = Builder.CreateFNeg(operandV, "negtmp");
+		else if (vType.type == INT_TYPE)
+			retV = Builder.CreateNSWNeg(operandV, "negtmp");
+		else
+			retV = Builder.CreateNeg(operandV, "negtmp");
 		break;
 	case '&':
-	{
-		switch (node->operand->type) {
-		case ID_AST:
-		{
-			IdNode *operandNode = dynamic_cast<IdNode*>(node->operand);
-			std::string nameStr = *operandNode->name;
-			retV = lookUp(nameStr);
-			break;
-		}	// end case
-		case ARRAY_ITEM_AST:
-		{
-			ArrayItemNode *operandNode = dynamic_cast<ArrayItemNode*>(node->operand);
-
-			int size = operandNode->index->nodes.size();
-
-			operandNode->array->accept(*this);
-			operandNode->index->accept(*this);
-
-			vector<Value*> indexVs = getValuesFromStack(size);
-			std::vector<Value *> idxList;
-			idxList.push_back(ConstantInt::get(getGlobalContext(), APInt(32, 0, true)));
-			for (int i = 0; i < size; i++) {
-				Value *sextIndex = Builder.CreateSExt(indexVs[i], Type::getInt64Ty(getGlobalContext()));
-				idxList.push_back(sextIndex);
-			}
-
-			Value *arrayPtr = pending.back();
-			pending.pop_back();
-
-			retV = Builder.CreateGEP(arrayPtr, idxList, "array_ptr");
-			break;
-		}	// end case
-		case UNARY_EXP_AST:
-		{
-			UnaryExpNode *operandNode = dynamic_cast<UnaryExpNode*>(node->operand);
-			operandNode->operand->accept(*this);
-			retV = pending.back();
-			pending.pop_back();
-			break;
-		}	// end case
-		case STRUCT_ITEM_AST:
-		{
-			StructItemNode *operandNode = dynamic_cast<StructItemNode*>(node->operand);
-			operandNode->stru->accept(*this);
-			Value *structPtr = pending.back();
-			pending.pop_back();
-
-			std::string structName;
-			if (operandNode->isPointer)
-				structName = *operandNode->stru->valueTy.atom->structName;
-			else
-				structName = *operandNode->stru->valueTy.structName;
-
-			std::map<std::string, int> &offsetMap = *structOffsetTable[structName];
-			int offset = offsetMap[*operandNode->itemName];
-			std::vector<Value *> idxV;
-			idxV.push_back(ConstantInt::get(getGlobalContext(), APInt(32, 0, true)));
-			idxV.push_back(ConstantInt::get(getGlobalContext(), APInt(32, offset, true)));
-			retV = Builder.CreateGEP(structPtr, idxV, "struct_item");
-
-			break;
-		}	// end case
-		default:
-			break;
-		}	// end inner switch
+		retV = getLValPtr(node->operand);
 		break;
-	}
 	case '*':
 	{
-		node->operand->accept(*this);
-		operandV = pending.back();
-		pending.pop_back();
+		operandV = visit(node->operand);
 		Type *type = ((AllocaInst*)operandV)->getAllocatedType();
 		if (type->isFunctionTy())
 			retV = operandV;
@@ -397,7 +787,7 @@ void CodegenVisitor::visitUnaryExpNode(UnaryExpNode *node)
 		else if (type->isStructTy())
 			retV = operandV;
 		else
-			retV = Builder.CreateLoad(operandV, "deref");
+			retV = createLoad(operandV, "deref");
 		break;
 	}
 	default:
@@ -406,33 +796,35 @@ void CodegenVisitor::visitUnaryExpNode(UnaryExpNode *node)
 	}
 
 	// type cast
-	ValueTypeS vType = node->valueTy;
 	if (vType.dstType != NO_TYPE && vType.dstType != vType.type) {
 		retV = typeCast(vType, retV);
 	}
 
-	pending.insert(pending.end(), retV);
+	return retV;
 }
 
 
-void CodegenVisitor::visitIdNode(IdNode *node)
+Value *CodegenVisitor::visitIdNode(IdNode *node)
 {
-	Value *vPtr = lookUp(*node->name);
+	// constants are used by value
+	ValueTypeS vType = types[node];
+	if (vType.isComputed)
+		return getConstant(vType);
+
+	Value *vPtr = lookUp(node);
 
 	Value *v;
 
 	// if this id is a function name
-	if (vPtr == nullptr) {
-		v = TheModule->getFunction(*node->name);
-	}
-
-	// if this id is an array
-	else if (((AllocaInst*)vPtr)->getAllocatedType()->isArrayTy()) {
+	if (isa<Function>(vPtr)) {
 		v = vPtr;
 	}
 
-	// if this id is a struct
-	else if (((AllocaInst*)vPtr)->getAllocatedType()->isStructTy()) {
+	// arrays and structs are used through their address, whether they live
+	// on the stack or in a global; as arguments that address is passed in
+	// and kept in the argument's slot like any other value
+	else if ((vType.type == ARRAY_TYPE || vType.type == STRUCT_TYPE)
+			&& types.declOf(node)->type != ID_AST) {
 		v = vPtr;
 	}
 
@@ -444,168 +836,205 @@ void CodegenVisitor::visitIdNode(IdNode *node)
 			v = ((GlobalVariable *)vPtr)->getInitializer();
 		}
 		else {
-			v = Builder.CreateLoad(vPtr, node->name->c_str());
+			v = createLoad(vPtr, *node->name);
 		}
 	}
 
 	// type cast
-	ValueTypeS vType = node->valueTy;
 	if (vType.dstType != NO_TYPE && vType.dstType != vType.type)
 		v = typeCast(vType, v);
 
-	pending.insert(pending.end(), v);
+	return v;
 }
 
 
-void CodegenVisitor::visitArrayItemNode(ArrayItemNode *node)
+Value *CodegenVisitor::visitArrayItemNode(ArrayItemNode *node)
 {
-	Value *retV;
-	int size = node->index->nodes.size();
-	vector<Value*> indexVs = getValuesFromStack(size);
-
-	std::vector<Value *> idxList;
-	idxList.push_back(ConstantInt::get(getGlobalContext(), APInt(32, 0, true)));
-	for (int i = 0; i < size; i++) {
-		Value *sextIndex = Builder.CreateSExt(indexVs[i], Type::getInt64Ty(getGlobalContext()));
-		idxList.push_back(sextIndex);
-	}
+	// item of a const array at a constant index
+	ValueTypeS vType = types[node];
+	if (vType.isComputed)
+		return getConstant(vType);
 
-	Value *arrayPtr = pending.back();
-	pending.pop_back();
-
-	Value *arrayItemPtr = Builder.CreateGEP(arrayPtr, idxList, "array_ptr");
-	retV = Builder.CreateLoad(arrayItemPtr, "array_item");
+	// arrays and structs are used through their address
+	Value *arrayItemPtr = getArrayItemPtr(node);
+	if (vType.type == ARRAY_TYPE || vType.type == STRUCT_TYPE)
+		return arrayItemPtr;
+	Value *retV = createLoad(arrayItemPtr, "array_item");
 
 	// type cast
-	ValueTypeS vType = node->valueTy;
 	if (vType.dstType != NO_TYPE && vType.dstType != vType.type) {
 		retV = typeCast(vType, retV);
 	}
 
-	pending.insert(pending.end(), retV);
+	return retV;
 }
 
 
-void CodegenVisitor::visitStructItemNode(StructItemNode *node)
+Value *CodegenVisitor::visitStructItemNode(StructItemNode *node)
 {
-	Value *structPtr = pending.back();
-	pending.pop_back();
-
-	std::string structName;
-	if (node->isPointer)
-		structName = *node->stru->valueTy.atom->structName;
-	else
-		structName = *node->stru->valueTy.structName;
-
-	std::map<std::string, int> &offsetMap = *structOffsetTable[structName];
-	int offset = offsetMap[*node->itemName];
-	std::vector<Value *> idxV;
-	idxV.push_back(ConstantInt::get(getGlobalContext(), APInt(32, 0, true)));
-	idxV.push_back(ConstantInt::get(getGlobalContext(), APInt(32, offset, true)));
-	Value *structItemPtr = Builder.CreateGEP(structPtr, idxV, "struct_item");
-
-	Value *retV = Builder.CreateLoad(structItemPtr, false);
+	// arrays and structs are used through their address
+	ValueTypeS vType = types[node];
+	MDNode *tag;
+	Value *structItemPtr = getStructItemPtr(node, &tag);
+	if (vType.type == ARRAY_TYPE || vType.type == STRUCT_TYPE)
+		return structItemPtr;
+	Value *retV = createLoad(structItemPtr, "", tag);
 
 	// type cast
-	ValueTypeS vType = node->valueTy;
 	if (vType.dstType != NO_TYPE && vType.dstType != vType.type) {
 		retV = typeCast(vType, retV);
 	}
 
-	pending.insert(pending.end(), retV);
+	return retV;
 }
 
 
-void CodegenVisitor::visitFunCallNode(FunCallNode *node)
+Value *CodegenVisitor::visitFunCallNode(FunCallNode *node)
 {
-	// get args
-	std::list<Node *> arguments;
-	if (node->hasArgs)
-		arguments = node->argv->nodes;
-
-	std::vector<Value *> argsV = getValuesFromStack(arguments.size());
-
 	// get callee
-	Function *calleeF = (Function *)pending.back();
-	pending.pop_back();
+	Function *calleeF = (Function *)visit(node->func);
+	ValueTypeS funcTy = types[node->func];
+	if (funcTy.type == PTR_TYPE)
+		funcTy = *funcTy.atom;
+	const ABIInfo &abi = classifyCall(funcTy);
+
+	// a struct result goes to a temporary of the caller's
+	ValueTypeS vType = types[node];
+	Value *resultPtr = 0;
+	std::vector<Value *> argsV;
+	if (vType.type == STRUCT_TYPE) {
+		Function *currentFunc = Builder.GetInsertBlock()->getParent();
+		IRBuilder<> TmpBuilder(&currentFunc->getEntryBlock(), currentFunc->getEntryBlock().begin());
+		resultPtr = TmpBuilder.CreateAlloca(getLLVMVarType(vType), 0, "call_result");
+		if (abi.ret.kind == ABIArg::INDIRECT)
+			argsV.push_back(resultPtr);
+	}
 
-	Value *retV = Builder.CreateCall(calleeF, argsV);
+	// get args, structs by address or in registers; the callee may be a
+	// pointer, so the call says which are byval too
+	std::vector<unsigned> byvalArgs;
+	FunctionType *calleeTy = cast<FunctionType>(cast<PointerType>(calleeF->getType())->getElementType());
+	if (node->hasArgs) {
+		int i = 0;
+		for (std::list<Node *>::iterator it = node->argv->nodes.begin();
+				it != node->argv->nodes.end(); it++, i++) {
+			const ABIArg &arg = abi.args[i];
+			Value *argV = visit(*it);
+			if (arg.kind == ABIArg::COERCED) {
+				Value *coerced = coerceFrom(arg, argV);
+				for (int part = 0; part < arg.nParts; part++) {
+					Value *partPtr = getCoercedPart(arg, coerced, part);
+					argsV.push_back(Builder.CreateLoad(partPtr));
+				}
+				continue;
+			}
+			// an array goes to a parameter whose first bound may differ
+			Type *paramTy = calleeTy->getParamType(argsV.size());
+			if (argV->getType() != paramTy && argV->getType()->isPointerTy())
+				argV = Builder.CreateBitCast(argV, paramTy);
+			argsV.push_back(argV);
+			if (arg.kind == ABIArg::INDIRECT)
+				byvalArgs.push_back(argsV.size());
+		}
+	}
+
+	CallInst *call = Builder.CreateCall(calleeF, argsV);
+	for (std::vector<unsigned>::iterator it = byvalArgs.begin(); it != byvalArgs.end(); it++)
+		call->addAttribute(*it, Attribute::ByVal);
+	if (abi.ret.kind == ABIArg::INDIRECT) {
+		call->addAttribute(1, Attribute::StructRet);
+		return resultPtr;
+	}
+	if (abi.ret.kind == ABIArg::COERCED) {
+		Value *coerced = createCoerced(abi.ret);
+		Builder.CreateStore(call, coerced);
+		coerceTo(coerced, resultPtr);
+		return resultPtr;
+	}
 
 	// type cast
-	ValueTypeS vType = node->valueTy;
+	Value *retV = call;
 	if (vType.dstType != NO_TYPE && vType.dstType != vType.type) {
 		retV = typeCast(vType, retV);
 	}
 
-	pending.insert(pending.end(), retV);
+	return retV;
 }
 
 
-void CodegenVisitor::visitIdVarDefNode(IdVarDefNode *node)
+Value *CodegenVisitor::visitIdVarDefNode(IdVarDefNode *node)
 {
+	// every use of a local constant is folded to its value, storage is only
+	// made if its address is taken, see lookUp()
+	if (Builder.GetInsertBlock() != 0 && types[node].isComputed)
+		return 0;
+
 	std::string *name = node->name;
-	Type *type = getLLVMVarType(node->valueTy);
+	Type *type = getLLVMVarType(types[node]);
+
+	Value *val = 0;
+	if (node->isAssigned)
+		val = visit(node->value);
+
 	// global variable
-	if (Builder.GetInsertBlock() == nullptr) {
+	if (Builder.GetInsertBlock() == 0) {
 		GlobalVariable *gVar = new GlobalVariable(*TheModule, /* module */
 				type, /* type */
-				node->valueTy.isConstant, 	/* is constant ? */
-				getLinkageTyp(node->valueTy), /* linkage */
+				types[node].isConstant, 	/* is constant ? */
+				getLinkageTyp(types[node]), /* linkage */
 				0,	/* initializer */
 				name->c_str() /* name */);
 
 		// initialization
-		Value *val = 0;
 		if (node->isAssigned) {
-			val = pending.back();
-			pending.pop_back();
-
 			gVar->setInitializer((Constant*)val);
 		}
 		else {
 			gVar->setInitializer(Constant::getNullValue(type));
 		}
 
-		GloblalVariables[*name] = gVar;
+		values[node->id] = gVar;
 	}
 	// local variable
 	else {
-		std::map<std::string, AllocaInst *> &LocalVariables = *LocalTableStack[StackPtr-1];
-
 		Function *currentFunc =
 				Builder.GetInsertBlock()->getParent();
 		IRBuilder<> TmpBuilder(&currentFunc->getEntryBlock(), currentFunc->getEntryBlock().begin());
 
 		AllocaInst *variable =
-				TmpBuilder.CreateAlloca(getLLVMVarType(node->valueTy), 0, name->c_str());
+				TmpBuilder.CreateAlloca(getLLVMVarType(types[node]), 0, name->c_str());
 
-		Value *val = 0;
 		if (node->isAssigned) {
-			val = pending.back();
-			pending.pop_back();
-			if (node->value->valueTy.type == STRUCT_TYPE)
-				val = Builder.CreateLoad(val);
-
-			Builder.CreateStore(val, variable);
+			if (types[node->value].type == STRUCT_TYPE)
+				createStructCopy(variable, val);
+			else
+				createStore(val, variable);
 		}
 
-		if (node->valueTy.isConstant) {
-			std::map<std::string, AllocaInst *> &ConstLocalVariables = *ConstLocalTableStack[StackPtr-1];
-			ConstLocalVariables[*name] = variable;
-		}
-		else {
-			std::map<std::string, AllocaInst *> &LocalVariables = *LocalTableStack[StackPtr-1];
-			LocalVariables[*name] = variable;
-		}
+		values[node->id] = variable;
 	}
+	return 0;
+}
 
+
+// runs of at least this many items of a local array initializer are filled
+// with memcpy or memset rather than one store each
+static const int BULK_INIT_MIN = 16;
+
+// address of item i of a local array being initialized
+static Value *getArrayInitPtr(Value *arrayPtr, int i, const std::string &name)
+{
+	std::vector<Value *> idxList;
+	idxList.push_back(ConstantInt::get(getGlobalContext(), APInt(32, 0, true)));
+	idxList.push_back(ConstantInt::get(getGlobalContext(), APInt(64, i, true)));
+	return Builder.CreateInBoundsGEP(arrayPtr, idxList, "array_init_" + name);
 }
 
 
-void CodegenVisitor::visitArrayVarDefNode(ArrayVarDefNode *node)
+Value *CodegenVisitor::visitArrayVarDefNode(ArrayVarDefNode *node)
 {
 	std::string *name = node->name;
-	ValueTypeS vType = node->valueTy;
+	ValueTypeS vType = types[node];
 
 	int valuesSize;
 	if (node->isAssigned)
@@ -613,43 +1042,68 @@ void CodegenVisitor::visitArrayVarDefNode(ArrayVarDefNode *node)
 	else
 		valuesSize = 0;
 
-	// get the size of array
+	// get the size of array; the checker rejects more items than that
 	int arraySize = vType.base[0];
+	if (valuesSize > arraySize)
+		valuesSize = arraySize;
 
-	ArrayType* arrayType = (ArrayType*)getLLVMVarType(vType);
+	std::vector<Value *> items;
+	if (node->isAssigned)
+		items = getValuesFromList(node->values);
 
-	// global variable
-	if (Builder.GetInsertBlock() == nullptr) {
+	ArrayType* arrayType = (ArrayType*)getLLVMVarType(vType);
 
-		// insert global variable
-		GlobalVariable *gVar = new GlobalVariable(*TheModule, /* module */
-						arrayType, 		/* type */
-						node->valueTy.isConstant, 	/* is constant ? */
-						getLinkageTyp(node->valueTy), /* linkage */
-						0,	/* initializer */
-						name->c_str() /* name */);
+	// a local const array initialized with constants is a table, it is
+	// emitted like a global instead of being built on the stack
+	bool isTable = vType.isConstant;
+	for (int i = 0; i < valuesSize && isTable; i++)
+		isTable = isa<Constant>(items[i]);
 
-		// initialize
-		std::vector<Constant *> arrayItems(arraySize);
-		if (node->isAssigned) {
-			std::vector<Value *> values = getValuesFromStack(valuesSize);
-			for (int i = 0; i < arraySize; ++i) {
-				if (i < valuesSize)
-					arrayItems[i] = (Constant *)(values[i]);
-				else
-					arrayItems[i] = Constant::getNullValue(arrayType->getArrayElementType());
-			}
-		}
+	// global variable
+	if (Builder.GetInsertBlock() == 0 || isTable) {
+		GlobalValue::LinkageTypes linkage = getLinkageTyp(types[node]);
+		if (Builder.GetInsertBlock() != 0)
+			linkage = GlobalValue::PrivateLinkage;
+
+		// initialize; only the items given are built one by one.  Without
+		// any the array is zeroinitializer, and a long zero tail is split off
+		// as a zeroinitializer of its own, the global then is a struct of the
+		// two parts, laid out just like the array
+		Type *itemType = arrayType->getArrayElementType();
+		int zeros = arraySize - valuesSize;
+		Constant *init;
+		if (valuesSize == 0)
+			init = ConstantAggregateZero::get(arrayType);
 		else {
-			for (int i = 0; i < arraySize; ++i) {
-				arrayItems[i] = Constant::getNullValue(arrayType->getArrayElementType());
+			std::vector<Constant *> arrayItems;
+			for (int i = 0; i < valuesSize; i++)
+				arrayItems.push_back((Constant *)items[i]);
+			if (zeros < BULK_INIT_MIN) {
+				for (int i = 0; i < zeros; i++)
+					arrayItems.push_back(Constant::getNullValue(itemType));
+				init = ConstantArray::get(arrayType, arrayItems);
+			}
+			else {
+				Constant *parts[] = {
+					ConstantArray::get(ArrayType::get(itemType, valuesSize), arrayItems),
+					ConstantAggregateZero::get(ArrayType::get(itemType, zeros))
+				};
+				init = ConstantStruct::getAnon(parts);
 			}
 		}
 
-		Constant* constArray = ConstantArray::get(arrayType, arrayItems);
-		gVar->setInitializer(constArray);
+		// insert global variable
+		GlobalVariable *gVar = new GlobalVariable(*TheModule, /* module */
+						init->getType(), 	/* type */
+						types[node].isConstant, 	/* is constant ? */
+						linkage, 		/* linkage */
+						init,	/* initializer */
+						name->c_str() /* name */);
 
-		GloblalVariables[*name] = gVar;
+		if (init->getType() == arrayType)
+			values[node->id] = gVar;
+		else
+			values[node->id] = ConstantExpr::getBitCast(gVar, arrayType->getPointerTo());
 	}
 	// local variable
 	else {
@@ -658,247 +1112,176 @@ void CodegenVisitor::visitArrayVarDefNode(ArrayVarDefNode *node)
 
 		AllocaInst *arrayPtr = TmpBuilder.CreateAlloca(arrayType, 0, name->c_str());
 
-		// initialize
+		// initialize: a long list of constants is copied from a private
+		// table and a long zero tail is cleared with memset, anything shorter
+		// is stored item by item
 		if (node->isAssigned) {
-			std::vector<Value *> values = getValuesFromStack(valuesSize);
-			for (int i = 0; i < arraySize; i++) {
-				Value *v;
-				if (i < valuesSize)
-					v = values[i];
-				else
-					v = Constant::getNullValue(arrayType->getArrayElementType());
-
-				std::vector<Value *> idxList;
-				idxList.push_back(ConstantInt::get(getGlobalContext(), APInt(32, 0, true)));
-				idxList.push_back(ConstantInt::get(getGlobalContext(), APInt(64, i, true)));
+			Type *itemType = arrayType->getArrayElementType();
+
+			bool copyItems = valuesSize >= BULK_INIT_MIN;
+			for (int i = 0; i < valuesSize && copyItems; i++)
+				copyItems = isa<Constant>(items[i]);
+
+			if (copyItems) {
+				std::vector<Constant *> tableItems;
+				for (int i = 0; i < valuesSize; i++)
+					tableItems.push_back((Constant *)items[i]);
+				ArrayType *tableType = ArrayType::get(itemType, valuesSize);
+				GlobalVariable *table = new GlobalVariable(*TheModule, tableType, true,
+						GlobalValue::PrivateLinkage, ConstantArray::get(tableType, tableItems),
+						"init." + *name);
+				table->setUnnamedAddr(true);
+				Builder.CreateMemCpy(arrayPtr, table, ConstantExpr::getSizeOf(tableType), 1);
+			}
+			else {
+				for (int i = 0; i < valuesSize; i++)
+					createStore(items[i], getArrayInitPtr(arrayPtr, i, *name));
+			}
 
-				Value *arrayItemPtr = Builder.CreateGEP(arrayPtr, idxList, "array_init_" + *name);
-				Builder.CreateStore(v, arrayItemPtr);
+			int zeros = arraySize - valuesSize;
+			if (zeros >= BULK_INIT_MIN) {
+				Constant *tailSize = ConstantExpr::getMul(ConstantExpr::getSizeOf(itemType),
+						ConstantInt::get(Type::getInt64Ty(getGlobalContext()), zeros));
+				Builder.CreateMemSet(getArrayInitPtr(arrayPtr, valuesSize, *name),
+						Builder.getInt8(0), tailSize, 1);
+			}
+			else {
+				for (int i = valuesSize; i < arraySize; i++)
+					createStore(Constant::getNullValue(itemType), getArrayInitPtr(arrayPtr, i, *name));
 			}
 		}
 
-		if (node->valueTy.isConstant) {
-			std::map<std::string, AllocaInst *> &ConstLocalVariables = *ConstLocalTableStack[StackPtr-1];
-			ConstLocalVariables[*name] = arrayPtr;
-		}
-		else {
-			std::map<std::string, AllocaInst *> &LocalVariables = *LocalTableStack[StackPtr-1];
-			LocalVariables[*name] = arrayPtr;
-		}
+		values[node->id] = arrayPtr;
 	}
+	return 0;
 }
 
 
-void CodegenVisitor::visitEmptyNode(EmptyNode *node)
+Value *CodegenVisitor::visitEmptyNode(EmptyNode *node)
 {
 	// empty
+	return 0;
 }
 
 
-void CodegenVisitor::visitBlockNode(BlockNode *node)
+Value *CodegenVisitor::visitBlockNode(BlockNode *node)
 {
-	// exit current scope
-	StackPtr--;
-	delete LocalTableStack[StackPtr];
-	delete ConstLocalTableStack[StackPtr];
+	// names were resolved by the checker, so a block needs no scope here
+	std::list<Node *> &items = node->blockItems->nodes;
+	for (std::list<Node *>::iterator it = items.begin(); it != items.end(); it++) {
+		if (!types.pruned(*it))
+			visit(*it);
+	}
+	return 0;
 }
 
 
-void CodegenVisitor::visitVarDeclNode(VarDeclNode *node)
+Value *CodegenVisitor::visitVarDeclNode(VarDeclNode *node)
 {
-	// empty
+	visit(node->defList);
+	return 0;
 }
 
 
-void CodegenVisitor::visitAssignStmtNode(AssignStmtNode *node)
+Value *CodegenVisitor::visitAssignStmtNode(AssignStmtNode *node)
 {
-	node->exp->accept(*this);
-	Value *expV = pending.back();
-	pending.pop_back();
+	Value *expV = visit(node->exp);
 	if (expV == 0)
-		return;
+		return 0;
+
+	MDNode *tag;
+	Value *lvalPtr = getLValPtr(node->lval, &tag);
+	if (lvalPtr == 0)
+		return 0;
+
+	// a struct is copied from the address expV holds
+	ValueTypeS lvalTy = types[node->lval];
+	if (lvalTy.type == STRUCT_TYPE) {
+		createStructCopy(lvalPtr, expV);
+		return 0;
+	}
 
-	ValueTypeS lvalTy = node->lval->valueTy;
-	ValueTypeS expTy = node->exp->valueTy;
+	// lval op exp, in the type the checker chose for the operation; the
+	// address is only worked out once
+	if (node->op != '=') {
+		ValueType opType = types[node].type;
+		Value *oldV = createLoad(lvalPtr, "", tag);
 
-	switch (node->lval->type) {
-	case ID_AST:
-	{
-		ValueTypeS vType = node->lval->valueTy;
+		lvalTy.dstType = opType;
+		if (lvalTy.type != opType)
+			oldV = typeCast(lvalTy, oldV);
 
-		// if this id is a struct
-		if (vType.type == STRUCT_TYPE) {
-			expV = Builder.CreateLoad(expV);
-		}
+		expV = createArith(node->op, opType, oldV, expV);
 
-		// id is atom type
-		IdNode *lval = dynamic_cast<IdNode *>(node->lval);
-		Value *lvalV = lookUp(*(lval->name));
-		Builder.CreateStore(expV, lvalV);
-		break;
+		ValueTypeS resultTy = types[node];
+		resultTy.dstType = lvalTy.type;
+		if (opType != lvalTy.type)
+			expV = typeCast(resultTy, expV);
 	}
-	case ARRAY_ITEM_AST:
-	{
-		ArrayItemNode *lval = dynamic_cast<ArrayItemNode *>(node->lval);
-		int size = lval->index->nodes.size();
-
-		lval->array->accept(*this);
-		lval->index->accept(*this);
-
-		vector<Value*> indexVs = getValuesFromStack(size);
-		std::vector<Value *> idxList;
-		idxList.push_back(ConstantInt::get(getGlobalContext(), APInt(32, 0, true)));
-		for (int i = 0; i < size; i++) {
-			Value *sextIndex = Builder.CreateSExt(indexVs[i], Type::getInt64Ty(getGlobalContext()));
-			idxList.push_back(sextIndex);
-		}
 
-		Value *arrayPtr = pending.back();
-		pending.pop_back();
+	createStore(expV, lvalPtr, tag);
+	return 0;
+}
 
-		Value *arrayItemPtr = Builder.CreateGEP(arrayPtr, idxList, "array_ptr");
-		Builder.CreateStore(expV, arrayItemPtr);
-		break;
-	}
-	case STRUCT_ITEM_AST:
-	{
-		StructItemNode *lval = dynamic_cast<StructItemNode*>(node->lval);
-		lval->stru->accept(*this);
-		Value *structPtr = pending.back();
-		pending.pop_back();
-
-		std::string structName;
-		if (lval->isPointer)
-			structName = *lval->stru->valueTy.atom->structName;
-		else
-			structName = *lval->stru->valueTy.structName;
 
-		std::map<std::string, int> &offsetMap = *structOffsetTable[structName];
-		int offset = offsetMap[*lval->itemName];
-		std::vector<Value *> idxV;
-		idxV.push_back(ConstantInt::get(getGlobalContext(), APInt(32, 0, true)));
-		idxV.push_back(ConstantInt::get(getGlobalContext(), APInt(32, offset, true)));
-		Value *structItemPtr = Builder.CreateGEP(structPtr, idxV, "struct_item");
+// the address an assignment to lval stores to, also what '&lval' is; *tag
+// is set to the TBAA tag for a struct member, 0 for the default one
+Value *CodegenVisitor::getLValPtr(ExpNode *lval, MDNode **tag)
+{
+	if (tag != 0)
+		*tag = 0;
 
-		Builder.CreateStore(expV, structItemPtr);
-		break;
-	}
+	switch (lval->type) {
+	case ID_AST:
+		return lookUp((IdNode *)lval);
+	case ARRAY_ITEM_AST:
+		return getArrayItemPtr((ArrayItemNode *)lval);
+	case STRUCT_ITEM_AST:
+		return getStructItemPtr((StructItemNode *)lval, tag);
 	case UNARY_EXP_AST:
-	{
-		UnaryExpNode *lval = dynamic_cast<UnaryExpNode*>(node->lval);
-		lval->operand->accept(*this);
-		Value *ptrV = pending.back();
-		pending.pop_back();
-
-		Builder.CreateStore(expV, ptrV);
-		break;
-	}
+		// *p
+		return visit(((UnaryExpNode *)lval)->operand);
 	default:
-		break;
+		return 0;
 	}
 }
 
 
-void CodegenVisitor::visitFunCallStmtNode(FunCallStmtNode *node)
+Value *CodegenVisitor::visitFunCallStmtNode(FunCallStmtNode *node)
 {
-	pending.pop_back();
+	visit(node->funCall);
+	return 0;
 }
 
 
-void CodegenVisitor::visitBlockStmtNode(BlockStmtNode *node)
+Value *CodegenVisitor::visitBlockStmtNode(BlockStmtNode *node)
 {
-	// empty
+	visit(node->block);
+	return 0;
 }
 
 
-void CodegenVisitor::visitCondNode(CondNode *node)
+// && || and ! only appear in the conditions of if and loops, which branch on
+// them through emitCondBr; what is left here are the comparisons.
+Value *CodegenVisitor::visitCondNode(CondNode *node)
 {
 	Value *lValue, *rValue;
-	PHINode *pn;
-	Function *theFunction;
-	BasicBlock *beginBB, *shortBB, *longBB;
 
-	char op = node->op;
-	switch (op) {
-	case OR_OP:
-	case AND_OP:
-		theFunction = Builder.GetInsertBlock()->getParent();
-		beginBB = BasicBlock::Create(getGlobalContext(), "begin_cond", theFunction);
-		longBB = BasicBlock::Create(getGlobalContext(), "long_path");
-		shortBB = BasicBlock::Create(getGlobalContext(), "short_path");
-
-		Builder.CreateBr(beginBB);
-		// begin block
-		Builder.SetInsertPoint(beginBB);
-
-		node->lhs->accept(*this);
-		lValue = pending.back();
-		pending.pop_back();
-		if (lValue == 0) {
-			pending.insert(pending.end(), 0);
-			return;
-		}
+	// folded by the checker
+	const ValueTypeS &vType = types[node];
+	if (vType.isComputed)
+		return ConstantInt::get(Type::getInt1Ty(getGlobalContext()), vType.constVal.ival != 0);
 
-		if (op == OR_OP)
-			Builder.CreateCondBr(lValue, shortBB, longBB);
-		else
-			Builder.CreateCondBr(lValue, longBB, shortBB);
-		beginBB = Builder.GetInsertBlock();
-
-		// long block (no shortcut)
-		theFunction->getBasicBlockList().push_back(longBB);
-		Builder.SetInsertPoint(longBB);
-
-		node->rhs->accept(*this);
-		rValue = pending.back();
-		pending.pop_back();
-		if (rValue == 0) {
-			pending.insert(pending.end(), 0);
-			return;
-		}
-
-		if (op == OR_OP)
-			rValue = Builder.CreateOr(lValue, rValue, "or_tmp");
-		else
-			rValue = Builder.CreateAnd(lValue, rValue, "and_tmp");
-		Builder.CreateBr(shortBB);
-		longBB = Builder.GetInsertBlock();
-
-		// short block (shortcut)
-		theFunction->getBasicBlockList().push_back(shortBB);
-		Builder.SetInsertPoint(shortBB);
-		pn = Builder.CreatePHI(Type::getInt1Ty(getGlobalContext()), 2, "cond_tmp");
-		pn->addIncoming(lValue, beginBB);
-		pn->addIncoming(rValue, longBB);
-		pending.insert(pending.end(), pn);
-		return;
-
-	case NOT_OP:
-		node->rhs->accept(*this);
-		rValue = pending.back();
-		pending.pop_back();
-		if (rValue == 0) {
-			pending.insert(pending.end(), 0);
-			return;
-		}
-		pending.insert(pending.end(), Builder.CreateNot(rValue));
-		return;
-
-	default:
-		break;
-	}
+	char op = node->op;
 
 	Value *retV;
-	node->rhs->accept(*this);
-	rValue = pending.back();
-	pending.pop_back();
-	node->lhs->accept(*this);
-	lValue = pending.back();
-	pending.pop_back();
+	rValue = visit(node->rhs);
+	lValue = visit(node->lhs);
 
 	if (rValue == 0 || lValue == 0)
 		retV = 0;
-	if (node->lhs->valueTy.type != FLOAT_TYPE) {
+	// both sides were promoted to float if either one is
+	if (types[node->lhs].type != FLOAT_TYPE && types[node->rhs].type != FLOAT_TYPE) {
 		switch (op) {
 		case LT_OP:
 			retV = Builder.CreateICmpSLT(lValue, rValue, "ltcmp");
@@ -948,166 +1331,393 @@ void CodegenVisitor::visitCondNode(CondNode *node)
 			break;
 		}
 	}
-	pending.insert(pending.end(), retV);
+	return retV;
 }
 
 
-void CodegenVisitor::visitIfStmtNode(IfStmtNode *node)
+Value *CodegenVisitor::visitIfStmtNode(IfStmtNode *node)
 {
-	node->cond->accept(*this);
-	Value *condV = pending.back();
-	pending.pop_back();
-	if (condV == 0)
-		return;
+	// only the branch a folded condition takes is there
+	const ValueTypeS &condType = types[node->cond];
+	if (condType.isComputed) {
+		if (condType.constVal.ival != 0)
+			visit(node->then_stmt);
+		else if (node->hasElse)
+			visit(node->else_stmt);
+		return 0;
+	}
 
 	Function *theFunction = Builder.GetInsertBlock()->getParent();
 
-	// Create blocks for the then and else cases.  Insert the 'then' block at the
-	// end of the function.
-	BasicBlock *thenBB =
-	      BasicBlock::Create(getGlobalContext(), "then", theFunction);
-	BasicBlock *elseBB = BasicBlock::Create(getGlobalContext(), "else");
+	// Create blocks for the then and else cases, without an else the
+	// condition goes straight to the merge block.
+	BasicBlock *thenBB = BasicBlock::Create(getGlobalContext(), "then");
 	BasicBlock *mergeBB = BasicBlock::Create(getGlobalContext(), "ifcont");
+	BasicBlock *elseBB = node->hasElse ? BasicBlock::Create(getGlobalContext(), "else") : mergeBB;
 
-	Builder.CreateCondBr(condV, thenBB, elseBB);
+	emitCondBr(node->cond, thenBB, elseBB);
 
 	// emit then block.
+	theFunction->getBasicBlockList().push_back(thenBB);
 	Builder.SetInsertPoint(thenBB);
-	node->then_stmt->accept(*this);
+	visit(node->then_stmt);
 	Builder.CreateBr(mergeBB);
 
 	// emit else block
-	theFunction->getBasicBlockList().push_back(elseBB);
-	Builder.SetInsertPoint(elseBB);
-	if (node->hasElse)
-		node->else_stmt->accept(*this);
-	Builder.CreateBr(mergeBB);
+	if (node->hasElse) {
+		theFunction->getBasicBlockList().push_back(elseBB);
+		Builder.SetInsertPoint(elseBB);
+		visit(node->else_stmt);
+		Builder.CreateBr(mergeBB);
+	}
 
 	// emit merge block.
 	theFunction->getBasicBlockList().push_back(mergeBB);
 	Builder.SetInsertPoint(mergeBB);
+	return 0;
+}
+
+
+Value *CodegenVisitor::visitWhileStmtNdoe(WhileStmtNode *node)
+{
+	emitLoop(node->cond, node->do_stmt, NULL);
+	return 0;
+}
+
+
+Value *CodegenVisitor::visitForStmtNode(ForStmtNode *node)
+{
+	if (node->hasInit)
+		visit(node->init);
+	emitLoop(node->hasCond ? node->cond : NULL, node->do_stmt, node->hasStep ? node->step : NULL);
+	return 0;
+}
+
+
+// A node whose first operand is itself is never shared, it names a loop.
+// The context keeps such nodes until it is destroyed, so the n-th loop of
+// every compile gets the same one instead of one more per compile; they
+// only have to differ within a module.
+static MDNode *getLoopID(unsigned n)
+{
+	static std::vector<MDNode *> loopIDs;
+	LLVMContext &context = getGlobalContext();
+	while (loopIDs.size() <= n) {
+		MDNode *temp = MDNode::getTemporary(context, None);
+		Metadata *args[] = {temp};
+		MDNode *loopID = MDNode::get(context, args);
+		loopID->replaceOperandWith(0, loopID);
+		MDNode::deleteTemporary(temp);
+		loopIDs.push_back(loopID);
+	}
+	return loopIDs[n];
+}
+
+
+// whether cond has && or || in it, i.e. is more than one branch
+static bool isShortCircuit(const CondNode *cond)
+{
+	switch (cond->op) {
+	case AND_OP:
+	case OR_OP:
+		return true;
+	case NOT_OP:
+		return isShortCircuit((const CondNode *)cond->rhs);
+	default:
+		return false;
+	}
 }
 
 
-void CodegenVisitor::visitWhileStmtNdoe(WhileStmtNode *node)
+// Branch to trueBB if cond holds and to falseBB if not.  && and || become a
+// chain of branches, each side jumping straight to where its value decides
+// the whole condition goes, and ! swaps the targets, so no i1 is ever built
+// for them.  Returns the last branch emitted.
+BranchInst *CodegenVisitor::emitCondBr(CondNode *cond, BasicBlock *trueBB, BasicBlock *falseBB)
 {
+	const ValueTypeS &vType = types[cond];
+	if (vType.isComputed)
+		return Builder.CreateBr(vType.constVal.ival != 0 ? trueBB : falseBB);
+
 	Function *theFunction = Builder.GetInsertBlock()->getParent();
+	BasicBlock *rhsBB;
+
+	switch (cond->op) {
+	case AND_OP:
+		rhsBB = BasicBlock::Create(getGlobalContext(), "and_rhs");
+		emitCondBr((CondNode *)cond->lhs, rhsBB, falseBB);
+		theFunction->getBasicBlockList().push_back(rhsBB);
+		Builder.SetInsertPoint(rhsBB);
+		return emitCondBr((CondNode *)cond->rhs, trueBB, falseBB);
+	case OR_OP:
+		rhsBB = BasicBlock::Create(getGlobalContext(), "or_rhs");
+		emitCondBr((CondNode *)cond->lhs, trueBB, rhsBB);
+		theFunction->getBasicBlockList().push_back(rhsBB);
+		Builder.SetInsertPoint(rhsBB);
+		return emitCondBr((CondNode *)cond->rhs, trueBB, falseBB);
+	case NOT_OP:
+		return emitCondBr((CondNode *)cond->rhs, falseBB, trueBB);
+	default:
+		return Builder.CreateCondBr(visit(cond), trueBB, falseBB);
+	}
+}
 
-	BasicBlock *condBB = BasicBlock::Create(getGlobalContext(), "cond", theFunction);
-	BasicBlock *bodyBB = BasicBlock::Create(getGlobalContext(), "body");
-	BasicBlock *endBB = BasicBlock::Create(getGlobalContext(), "end");
-
-	// Cond basic block
-	Builder.CreateBr(condBB);
-	Builder.SetInsertPoint(condBB);
-	node->cond->accept(*this);
-	Value *condV = pending.back();
-	pending.pop_back();
-	if (condV == 0)
+
+// Loops are emitted rotated, in the form the loop passes expect:
+//
+//     guard:      br cond, preheader, end
+//     preheader:  br body
+//     body:       ...               ; continue goes to latch, break to exit
+//     latch:      step; br cond, body, exit    !llvm.loop
+//     exit:       br end
+//     end:
+//
+// so an iteration takes one conditional branch, the latch is the only back
+// edge, and the exit is only reached from inside the loop.  A missing or
+// folded condition leaves out the guard or the loop.
+void CodegenVisitor::emitLoop(CondNode *cond, StmtNode *body, StmtNode *step)
+{
+	bool always = cond == NULL || types[cond].isComputed;
+	if (cond != NULL && always && types[cond].constVal.ival == 0)
 		return;
-	Builder.CreateCondBr(condV, bodyBB, endBB);
 
-	// Body basic block
+	Function *theFunction = Builder.GetInsertBlock()->getParent();
+	LLVMContext &context = getGlobalContext();
+
+	BasicBlock *preheaderBB = BasicBlock::Create(context, "loop_preheader", theFunction);
+	BasicBlock *bodyBB = BasicBlock::Create(context, "loop_body");
+	BasicBlock *latchBB = BasicBlock::Create(context, "loop_latch");
+	BasicBlock *exitBB = BasicBlock::Create(context, "loop_exit");
+	BasicBlock *endBB = BasicBlock::Create(context, "loop_end");
+
+	// guard
+	if (always)
+		Builder.CreateBr(preheaderBB);
+	else
+		emitCondBr(cond, preheaderBB, endBB);
+
+	Builder.SetInsertPoint(preheaderBB);
+	Builder.CreateBr(bodyBB);
+
 	theFunction->getBasicBlockList().push_back(bodyBB);
 	Builder.SetInsertPoint(bodyBB);
-	node->do_stmt->accept(*this);
-	Builder.CreateBr(condBB);
+	LoopTargets targets = {latchBB, exitBB};
+	loops.push_back(targets);
+	visit(body);
+	loops.pop_back();
+	Builder.CreateBr(latchBB);
+
+	// latch, the condition is evaluated a second time here; with || in it
+	// several branches would go back to the body, so they meet first
+	theFunction->getBasicBlockList().push_back(latchBB);
+	Builder.SetInsertPoint(latchBB);
+	if (step != NULL)
+		visit(step);
+	BranchInst *backEdge;
+	if (always)
+		backEdge = Builder.CreateBr(bodyBB);
+	else if (!isShortCircuit(cond))
+		backEdge = emitCondBr(cond, bodyBB, exitBB);
+	else {
+		BasicBlock *backBB = BasicBlock::Create(context, "loop_backedge");
+		emitCondBr(cond, backBB, exitBB);
+		theFunction->getBasicBlockList().push_back(backBB);
+		Builder.SetInsertPoint(backBB);
+		backEdge = Builder.CreateBr(bodyBB);
+	}
+
+	backEdge->setMetadata("llvm.loop", getLoopID(loopCount++));
+
+	theFunction->getBasicBlockList().push_back(exitBB);
+	Builder.SetInsertPoint(exitBB);
+	Builder.CreateBr(endBB);
 
-	// End basic block
 	theFunction->getBasicBlockList().push_back(endBB);
 	Builder.SetInsertPoint(endBB);
 }
 
 
-void CodegenVisitor::visitReturnStmtNdoe(ReturnStmtNode *node)
+// Nothing has to run on the way out of a function, so every return is a ret
+// of its own and no return slot is needed.
+Value *CodegenVisitor::visitReturnStmtNdoe(ReturnStmtNode *node)
+{
+	Function *F = Builder.GetInsertBlock()->getParent();
+	Type *retTy = F->getReturnType();
+	Value *retV = 0;
+	if (node->hasExp)
+		retV = visit(node->exp);
+
+	// a struct is copied to where the caller wants it, or to the registers
+	// it is returned in
+	if (curABI.ret.kind == ABIArg::INDIRECT && retV != 0)
+		createStructCopy(F->arg_begin(), retV);
+	else if (curABI.ret.kind == ABIArg::COERCED && retV != 0) {
+		Value *coerced = coerceFrom(curABI.ret, retV);
+		retV = Builder.CreateLoad(coerced);
+	}
+
+	if (retTy->isVoidTy())
+		Builder.CreateRetVoid();
+	else
+		Builder.CreateRet(retV != 0 ? retV : UndefValue::get(retTy));
+	openDeadBlock();
+	return 0;
+}
+
+
+// Whatever is emitted after a jump or a return goes to a new block without
+// predecessors, which CFG simplification deletes; this keeps every block
+// ending in exactly one terminator.
+void CodegenVisitor::openDeadBlock()
 {
-	Value *retV = pending.back();
-	pending.pop_back();
+	Function *theFunction = Builder.GetInsertBlock()->getParent();
+	BasicBlock *afterBB = BasicBlock::Create(getGlobalContext(), "after_jump", theFunction);
+	Builder.SetInsertPoint(afterBB);
+}
+
 
-	Builder.CreateStore(retV, returnValue);
+void CodegenVisitor::jumpTo(BasicBlock *target)
+{
+	Builder.CreateBr(target);
+	openDeadBlock();
 }
 
 
-void CodegenVisitor::visitBreakStmtNode(BreakStmtNode *node)
+Value *CodegenVisitor::visitBreakStmtNode(BreakStmtNode *node)
 {
-	// bug exists, so keep empty
+	// the checker makes sure there is a loop
+	jumpTo(loops.back().breakBB);
+	return 0;
 }
 
 
-void CodegenVisitor::visitContinueStmtNode(ContinueStmtNode *node)
+Value *CodegenVisitor::visitContinueStmtNode(ContinueStmtNode *node)
 {
-	// bug exists, so keep empty
+	jumpTo(loops.back().continueBB);
+	return 0;
 }
 
 
-void CodegenVisitor::visitFuncDeclNode(FuncDeclNode *node)
+Value *CodegenVisitor::visitFuncDeclNode(FuncDeclNode *node)
 {
 	std::string *name = node->name;
 	std::list<Node *> argNames;
 	if (node->hasArgs)
-		argNames = node->valueTy.argv->nodes;
+		argNames = types[node].argv->nodes;
 
 
-	FunctionType *FT = (FunctionType *)getLLVMVarType(node->valueTy);
+	FunctionType *FT = (FunctionType *)getLLVMVarType(types[node]);
 
 	Function *F =
-	      Function::Create(FT, getLinkageTyp(node->valueTy), name->c_str(), TheModule);
+	      Function::Create(FT, getLinkageTyp(types[node]), name->c_str(), TheModule);
+
+	// neither the program nor the runtime can throw
+	F->addFnAttr(Attribute::NoUnwind);
+	if (effects != 0) {
+		MemEffect mem = effects->memEffect(node);
+		if (mem == NO_MEM)
+			F->addFnAttr(Attribute::ReadNone);
+		else if (mem == READ_MEM)
+			F->addFnAttr(Attribute::ReadOnly);
+	}
 
 	// set names for all arguments
+	const ABIInfo &abi = classifyCall(types[node]);
 	Function::arg_iterator aIt = F->arg_begin();
+	unsigned argIdx = 1;
+	if (abi.ret.kind == ABIArg::INDIRECT) {
+		aIt->setName("agg.result");
+		F->addAttribute(argIdx, Attribute::StructRet);
+		F->addAttribute(argIdx, Attribute::NoAlias);
+		aIt++;
+		argIdx++;
+	}
+	int i = 0;
 	for (std::list<Node *>::iterator it = argNames.begin();
-			it != argNames.end(); it++, aIt++) {
+			it != argNames.end(); it++, i++) {
 		IdNode *arg = (IdNode *)(*it);
+		if (abi.args[i].kind == ABIArg::COERCED) {
+			for (int part = 0; part < abi.args[i].nParts; part++, aIt++, argIdx++)
+				aIt->setName(*(arg->name) + ".coerce");
+			continue;
+		}
 		aIt->setName(*(arg->name));
+		if (abi.args[i].kind == ABIArg::INDIRECT)
+			F->addAttribute(argIdx, Attribute::ByVal);
+
+		if (effects != 0 && aIt->getType()->isPointerTy()) {
+			if (effects->argNoCapture(arg))
+				F->addAttribute(argIdx, Attribute::NoCapture);
+			if (effects->argReadOnly(arg))
+				F->addAttribute(argIdx, Attribute::ReadOnly);
+		}
+		aIt++;
+		argIdx++;
 	}
+
+	values[node->id] = F;
+	return F;
 }
 
 
-void CodegenVisitor::visitFuncDefNode(FuncDefNode *node)
+Value *CodegenVisitor::visitFuncDefNode(FuncDefNode *node)
 {
-	// enter new scope
-	LocalTableStack[StackPtr] = new std::map<std::string, AllocaInst *>;
-	ConstLocalTableStack[StackPtr] = new std::map<std::string, AllocaInst *>;
-	StackPtr++;
-
-	node->decl->accept(*this);
-	Function *F = TheModule->getFunction(*(node->decl->name));
+	Function *F = (Function *)visit(node->decl);
 	if (F == 0)
-		return;
+		return 0;
 
-	std::map<std::string, AllocaInst *> &LocalVariables = *LocalTableStack[StackPtr-1];
+	// unchanged since the last compilation, see cloneReusedBodies()
+	if (deps != 0 && deps->reusable(node)) {
+		reused.push_back(F);
+		return 0;
+	}
 
 	// insert entry block
 	BasicBlock *BB = BasicBlock::Create(getGlobalContext(), "entry", F);
 	Builder.SetInsertPoint(BB);
 
-	// create end function BB
-	funcEndBB = BasicBlock::Create(getGlobalContext(), "end_function");
-
-	// create an alloca for return value
-	ValueTypeS retTy = *node->decl->valueTy.atom;
-	if (retTy.type == VOID_TYPE)
-		retTy.type = INT_TYPE;
-	returnValue = Builder.CreateAlloca(getLLVMVarType(retTy), 0, "return_value");
-
 	// create an alloca for each argument
-	for (Function::arg_iterator aIt = F->arg_begin(); aIt != F->arg_end(); aIt++) {
-		AllocaInst *alloca = Builder.CreateAlloca(aIt->getType(), 0, aIt->getName());
-		Builder.CreateStore(aIt, alloca);
-		LocalVariables[aIt->getName()] = alloca;
-	}
+	std::list<Node *> argNodes;
+	if (node->decl->hasArgs)
+		argNodes = types[node->decl].argv->nodes;
+	curABI = classifyCall(types[node->decl]);
+	Function::arg_iterator aIt = F->arg_begin();
+	if (curABI.ret.kind == ABIArg::INDIRECT)
+		aIt++;
+	int i = 0;
+	for (std::list<Node *>::iterator argIt = argNodes.begin();
+			argIt != argNodes.end(); argIt++, i++) {
+		// a struct in registers is put back together in memory, its slot
+		// holds the address like that of a byval struct
+		const ABIArg &arg = curABI.args[i];
+		Value *argV = aIt;
+		if (arg.kind == ABIArg::COERCED) {
+			Value *coerced = createCoerced(arg);
+			for (int part = 0; part < arg.nParts; part++, aIt++)
+				Builder.CreateStore(aIt, getCoercedPart(arg, coerced, part));
+			std::string *name = ((IdNode *)(*argIt))->name;
+			argV = Builder.CreateAlloca(getLLVMVarType(types[*argIt]), 0, *name);
+			coerceTo(coerced, argV);
+		}
+		else
+			aIt++;
 
+		AllocaInst *alloca = Builder.CreateAlloca(argV->getType(), 0, argV->getName());
+		createStore(argV, alloca);
+		values[(*argIt)->id] = alloca;
+	}
 
-	node->block->accept(*this);
 
-	Builder.CreateBr(funcEndBB);
-	F->getBasicBlockList().push_back(funcEndBB);
-	Builder.SetInsertPoint(funcEndBB);
+	visit(node->block);
 
-	if (F->getReturnType() == Type::getVoidTy(getGlobalContext()))
+	// falling off the end returns nothing in particular, except from main
+	Type *retTy = F->getReturnType();
+	if (retTy->isVoidTy())
 		Builder.CreateRetVoid();
+	else if (*node->decl->name == "main")
+		Builder.CreateRet(Constant::getNullValue(retTy));
 	else
-		Builder.CreateRet(Builder.CreateLoad(returnValue));
+		Builder.CreateRet(UndefValue::get(retTy));
 
 
     // validate the generated code, checking for consistency
@@ -1117,74 +1727,86 @@ void CodegenVisitor::visitFuncDefNode(FuncDefNode *node)
 	TheFPM->run(*F);
 
 	Builder.ClearInsertionPoint();
-
-
-	// exit current scope
-	StackPtr--;
-	delete LocalTableStack[StackPtr];
-	delete ConstLocalTableStack[StackPtr];
+	return 0;
 }
 
 
-void CodegenVisitor::visitStructDefNode(StructDefNode *node)
+// one element per member, in the order the checker numbered them
+std::vector<Type *> CodegenVisitor::getMemberTypes(StructDefNode *node)
 {
-	std::string nameStr = *node->name;
-
-	std::map<std::string, int> *structOffset = new std::map<std::string, int>;
-	StructType *structType = StructType::create(getGlobalContext(), nameStr);
 	std::vector<Type*> attrTypes;
-
-	std::list<Node *> nodes = node->decls->nodes;
-	int i = 0;
+	std::list<Node *> &nodes = node->decls->nodes;
 	for (std::list<Node*>::iterator it = nodes.begin();
 			it != nodes.end(); ++it) {
-		attrTypes.push_back(getLLVMVarType((*it)->valueTy));
-		Node *defNode = dynamic_cast<VarDeclNode*>(*it)->defList->nodes.front();
-		std::string attrName = *dynamic_cast<VarDefNode*>(defNode)->name;
-		(*structOffset)[attrName] = i;
-		++i;
+		if ((*it)->type != VAR_DECL_AST)
+			continue;
+		std::list<Node *> &defs = ((VarDeclNode *)(*it))->defList->nodes;
+		for (std::list<Node *>::iterator defIt = defs.begin(); defIt != defs.end(); ++defIt) {
+			if ((*defIt)->type == ID_VAR_DEF_AST || (*defIt)->type == ARRAY_VAR_DEF_AST)
+				attrTypes.push_back(getLLVMVarType(types[*defIt]));
+		}
 	}
-
-	structOffsetTable[nameStr] = structOffset;
-
-	structType->setBody(attrTypes, false);
-}
-
-
-void CodegenVisitor::visitCompUnitNode(CompUnitNode *node)
-{
-	// empty
-}
-
-
-void CodegenVisitor::enterBlockNode(BlockNode *node)
-{
-	// enter new scope
-	LocalTableStack[StackPtr] = new std::map<std::string, AllocaInst *>;
-	ConstLocalTableStack[StackPtr] = new std::map<std::string, AllocaInst *>;
-	StackPtr++;
+	return attrTypes;
 }
 
 
-void CodegenVisitor::enterIfStmtNode(IfStmtNode *node)
+// Types belong to the context, which outlives the module.  A struct of the
+// same name and members left by an earlier compile in this process is taken
+// over instead of piling up renamed copies in the context.
+// Named struct types live as long as the context, and a name once taken is
+// not given out again: LLVM calls the next struct S "S.0", and so on.  So the
+// module finds its structs through structTypes, never by name in the
+// context, and a host compiling over and over reuses a struct made by an
+// earlier compile when the members are the same, instead of making one more
+// type per compile.
+Value *CodegenVisitor::visitStructDefNode(StructDefNode *node)
 {
-	// empty
-}
+	typedef std::multimap<std::string, StructType *>::iterator MadeIt;
+	static std::multimap<std::string, StructType *> made;
+	std::string nameStr = *node->name;
 
+	std::pair<MadeIt, MadeIt> sameName = made.equal_range(nameStr);
+	for (MadeIt it = sameName.first; it != sameName.second; it++) {
+		// the members may refer to the struct itself
+		StructType *structType = it->second;
+		structTypes[nameStr] = structType;
+		std::vector<Type *> attrTypes = getMemberTypes(node);
+		if (std::vector<Type *>(structType->element_begin(), structType->element_end()) == attrTypes)
+			return 0;
+		typeCache.clear();
+		abiCache.clear();
+	}
 
-void CodegenVisitor::enterWhileStmtNode(WhileStmtNode *node)
-{
-	// empty
+	StructType *structType = StructType::create(getGlobalContext(), nameStr);
+	made.insert(std::make_pair(nameStr, structType));
+	structTypes[nameStr] = structType;
+	structType->setBody(getMemberTypes(node), false);
+	return 0;
 }
 
 
-void CodegenVisitor::enterFuncDefNode(FuncDefNode *node)
+Value *CodegenVisitor::visitCompUnitNode(CompUnitNode *node)
 {
-	//empty
-}
-
+	for (std::list<Node *>::iterator it = node->nodes.begin();
+			it != node->nodes.end(); it++) {
+		// leave out the functions and globals nothing live refers to
+		if (effects != 0 && (*it)->type == FUNC_DEF_AST) {
+			if (effects->isLive(((FuncDefNode *)(*it))->decl))
+				visit(*it);
+		}
+		else if (effects != 0 && (*it)->type == VAR_DECL_AST) {
+			std::list<Node *> &defs = ((VarDeclNode *)(*it))->defList->nodes;
+			for (std::list<Node *>::iterator defIt = defs.begin(); defIt != defs.end(); defIt++)
+				if (effects->isLive(*defIt))
+					visit(*defIt);
+		}
+		else
+			visit(*it);
+	}
 
-void CodegenVisitor::enterStructDefNode(StructDefNode *node)
-{
+	// every function a kept body may call is declared by now
+	if (!reused.empty())
+		cloneReusedBodies();
+	return 0;
 }
 
@@ -0,0 +1,298 @@
+#include <cstdio>
+#include <list>
+#include "dep_graph.h"
+
+using namespace std;
+
+
+// name declared by an element of a VarDecl's defList
+static const string *defName(Node *def)
+{
+	switch (def->type) {
+	case ID_VAR_DEF_AST:
+	case ARRAY_VAR_DEF_AST:
+		return ((VarDefNode *)def)->name;
+	case FUNC_DECL_AST:
+		return ((FuncDeclNode *)def)->name;
+	default:
+		return NULL;
+	}
+}
+
+
+void DepGraph::build(CompUnitNode *root, const string &source)
+{
+	items.clear();
+	byName.clear();
+	byNode.clear();
+
+	for (list<Node *>::iterator it = root->nodes.begin();
+			it != root->nodes.end(); it++) {
+		// an item runs up to the next one
+		list<Node *>::iterator next = it;
+		next++;
+		SrcLoc end = next == root->nodes.end() ? source.size() : (*next)->loc;
+		SrcLoc bodyFrom = end;
+
+		DepItem item;
+		item.node = *it;
+		item.hasBody = false;
+		item.changed = false;
+		item.reuse = false;
+
+		switch ((*it)->type) {
+		case FUNC_DEF_AST:
+		{
+			FuncDefNode *func = (FuncDefNode *)(*it);
+			item.names.push_back(*func->decl->name);
+			item.hasBody = true;
+			bodyFrom = func->block->loc;
+			break;
+		}
+		case STRUCT_DEF_AST:
+			item.names.push_back("struct." + *((StructDefNode *)(*it))->name);
+			break;
+		case VAR_DECL_AST:
+		{
+			list<Node *> &defs = ((VarDeclNode *)(*it))->defList->nodes;
+			for (list<Node *>::iterator defIt = defs.begin(); defIt != defs.end(); defIt++) {
+				const string *name = defName(*defIt);
+				if (name != NULL)
+					item.names.push_back(*name);
+			}
+			break;
+		}
+		default:
+			break;
+		}
+
+		if (item.names.empty())
+			continue;
+		item.name = item.names[0];
+		item.declHash = hashText(source, (*it)->loc, bodyFrom);
+		item.bodyHash = hashText(source, bodyFrom, end);
+		addItem(item);
+	}
+}
+
+
+void DepGraph::addItem(const DepItem &item)
+{
+	int i = items.size();
+	items.push_back(item);
+	for (vector<string>::const_iterator it = item.names.begin(); it != item.names.end(); it++)
+		byName.insert(make_pair(*it, i));
+	if (item.node != NULL)
+		byNode[item.node] = i;
+}
+
+
+int DepGraph::size() const
+{
+	return items.size();
+}
+
+
+DepItem &DepGraph::item(int i)
+{
+	return items[i];
+}
+
+
+const DepItem &DepGraph::item(int i) const
+{
+	return items[i];
+}
+
+
+int DepGraph::find(const string &name) const
+{
+	map<string, int>::const_iterator it = byName.find(name);
+	return it == byName.end() ? -1 : it->second;
+}
+
+
+int DepGraph::itemOf(const Node *node) const
+{
+	map<const Node *, int>::const_iterator it = byNode.find(node);
+	return it == byNode.end() ? -1 : it->second;
+}
+
+
+void DepGraph::use(int i, const string &name, bool inBody)
+{
+	if (inBody)
+		items[i].bodyUses.insert(name);
+	else
+		items[i].uses.insert(name);
+}
+
+
+// whether item i uses something that changed, is gone, or now comes after it
+bool DepGraph::usesChanged(int i, const set<string> &uses) const
+{
+	for (set<string>::const_iterator it = uses.begin(); it != uses.end(); it++) {
+		int j = find(*it);
+		if (j == -1 || j > i || (j != i && items[j].changed))
+			return true;
+	}
+	return false;
+}
+
+
+void DepGraph::compare(const DepGraph &prev)
+{
+	vector<int> prevOf(items.size());
+
+	// changed by their own text, or new
+	for (int i = 0; i < (int)items.size(); i++) {
+		DepItem &item = items[i];
+		prevOf[i] = prev.find(item.name);
+		item.changed = prevOf[i] == -1
+			|| prev.items[prevOf[i]].declHash != item.declHash
+			|| prev.items[prevOf[i]].names != item.names;
+		item.reuse = false;
+	}
+
+	// changed through what they use, until nothing more changes; the uses
+	// of an item whose text is the same are the ones it had last time
+	bool again = true;
+	while (again) {
+		again = false;
+		for (int i = 0; i < (int)items.size(); i++) {
+			if (!items[i].changed && usesChanged(i, prev.items[prevOf[i]].uses)) {
+				items[i].changed = true;
+				again = true;
+			}
+		}
+	}
+
+	// bodies to keep, they won't be checked so they keep their uses too
+	for (int i = 0; i < (int)items.size(); i++) {
+		DepItem &item = items[i];
+		if (!item.hasBody || item.changed)
+			continue;
+		const DepItem &prevItem = prev.items[prevOf[i]];
+		if (prevItem.hasBody && prevItem.bodyHash == item.bodyHash
+				&& !usesChanged(i, prevItem.bodyUses)) {
+			item.reuse = true;
+			item.bodyUses = prevItem.bodyUses;
+		}
+	}
+}
+
+
+bool DepGraph::reusable(const Node *node) const
+{
+	int i = itemOf(node);
+	return i != -1 && items[i].reuse;
+}
+
+
+void DepGraph::dontReuse(int i)
+{
+	items[i].reuse = false;
+	items[i].bodyUses.clear();
+}
+
+
+// one item per line:
+// name declHash bodyHash hasBody nNames names... nUses uses... nBodyUses bodyUses...
+static void saveNames(FILE *fp, const vector<string> &names)
+{
+	fprintf(fp, " %lu", (unsigned long)names.size());
+	for (vector<string>::const_iterator it = names.begin(); it != names.end(); it++)
+		fprintf(fp, " %s", it->c_str());
+}
+
+static bool loadNames(FILE *fp, vector<string> *names)
+{
+	unsigned long n;
+	char buffer[500];
+
+	if (fscanf(fp, "%lu", &n) != 1)
+		return false;
+	names->clear();
+	for (unsigned long i = 0; i < n; i++) {
+		if (fscanf(fp, "%499s", buffer) != 1)
+			return false;
+		names->push_back(buffer);
+	}
+	return true;
+}
+
+
+bool DepGraph::save(const char *fileName) const
+{
+	FILE *fp = fopen(fileName, "w");
+	if (fp == NULL)
+		return false;
+
+	for (vector<DepItem>::const_iterator it = items.begin(); it != items.end(); it++) {
+		fprintf(fp, "%s %lu %lu %d", it->name.c_str(), it->declHash, it->bodyHash, it->hasBody ? 1 : 0);
+		saveNames(fp, it->names);
+		saveNames(fp, vector<string>(it->uses.begin(), it->uses.end()));
+		saveNames(fp, vector<string>(it->bodyUses.begin(), it->bodyUses.end()));
+		fprintf(fp, "\n");
+	}
+
+	fclose(fp);
+	return true;
+}
+
+
+// false if there is no usable graph in fileName, the graph is then empty
+bool DepGraph::load(const char *fileName)
+{
+	char buffer[500];
+	int hasBody;
+	vector<string> names;
+
+	items.clear();
+	byName.clear();
+	byNode.clear();
+
+	FILE *fp = fopen(fileName, "r");
+	if (fp == NULL)
+		return false;
+
+	DepItem item;
+	item.node = NULL;
+	item.changed = false;
+	item.reuse = false;
+	while (fscanf(fp, "%499s %lu %lu %d", buffer, &item.declHash, &item.bodyHash, &hasBody) == 4) {
+		item.name = buffer;
+		item.hasBody = hasBody != 0;
+		if (!loadNames(fp, &item.names))
+			break;
+		if (!loadNames(fp, &names))
+			break;
+		item.uses = set<string>(names.begin(), names.end());
+		if (!loadNames(fp, &names))
+			break;
+		item.bodyUses = set<string>(names.begin(), names.end());
+		addItem(item);
+	}
+
+	bool ok = feof(fp) != 0;
+	fclose(fp);
+	if (!ok) {
+		items.clear();
+		byName.clear();
+	}
+	return ok;
+}
+
+
+// FNV-1a over the source text in [from, to)
+unsigned long DepGraph::hashText(const string &source, SrcLoc from, SrcLoc to)
+{
+	unsigned long h = 14695981039346656037UL;
+	if (to > source.size())
+		to = source.size();
+	for (SrcLoc i = from; i < to; i++) {
+		h ^= (unsigned char)source[i];
+		h *= 1099511628211UL;
+	}
+	return h;
+}
@@ -8,11 +8,11 @@
 using namespace std;
 
 
-void DumpDotVisitor::dumpList(int length, int nRoot, int pos)
+void DumpDotVisitor::dumpList(list<Node *> &nodes, int nRoot, int pos)
 {
-	for (int i = 0; i < length; i++) {
-		int nChild = pending.back();
-		pending.pop_back();
+	for (list<Node *>::iterator it = nodes.begin();
+			it != nodes.end(); it++) {
+		int nChild = visit(*it);
 		dumper->drawLine(nRoot, pos, nChild);
 	}
 }
@@ -20,7 +20,6 @@ void DumpDotVisitor::dumpList(int length, int nRoot, int pos)
 
 DumpDotVisitor::DumpDotVisitor(FILE *file)
 {
-	orderChanged = false;
 	dumper = new DumpDOT(file);
 }
 
@@ -31,168 +30,154 @@ DumpDotVisitor::~DumpDotVisitor()
 }
 
 
-void DumpDotVisitor::visitNodeList(NodeList *node)
+int DumpDotVisitor::visitNodeList(NodeList *node)
 {
+	// lists are drawn by their owner through dumpList()
+	return 0;
 }
 
 
-void DumpDotVisitor::visitNumNode(NumNode *node)
+int DumpDotVisitor::visitNumNode(NumNode *node)
 {
 	std::stringstream ss;
 	ss << node->val;
 	int nThis = dumper->newNode(1, ss.str().c_str());
-	pending.insert(pending.end(), nThis);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitFNumNode(FNumNode *node)
+int DumpDotVisitor::visitFNumNode(FNumNode *node)
 {
 	std::stringstream ss;
 	ss << node->fval;
 	int nThis = dumper->newNode(1, ss.str().c_str());
-	pending.insert(pending.end(), nThis);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitCharNode(CharNode *node)
+int DumpDotVisitor::visitCharNode(CharNode *node)
 {
 	std::stringstream ss;
 	ss << node->cval;
 	int nThis = dumper->newNode(1, ss.str().c_str());
-	pending.insert(pending.end(), nThis);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitBinaryExpNode(BinaryExpNode *node)
+int DumpDotVisitor::visitBinaryExpNode(BinaryExpNode *node)
 {
 	char st[2] = " ";
 	st[0] = node->op;
+	int nlhs = visit(node->lhs);
+	int nrhs = visit(node->rhs);
 	int nThis = dumper->newNode(3, " ", st, " ");
 
-	int nrhs = pending.back();
-	pending.pop_back();
-	int nlhs = pending.back();
-	pending.pop_back();
-
 	dumper->drawLine(nThis, 0, nlhs);
 	dumper->drawLine(nThis, 2, nrhs);
-	pending.insert(pending.end(), nThis);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitUnaryExpNode(UnaryExpNode *node)
+int DumpDotVisitor::visitUnaryExpNode(UnaryExpNode *node)
 {
 	char st[2] = " ";
 	st[0] = node->op;
+	int nOperand = visit(node->operand);
 	int nThis = dumper->newNode(2, st, " ");
 
-	int nOperand = pending.back();
-	pending.pop_back();
-
 	dumper->drawLine(nThis, 1, nOperand);
-	pending.insert(pending.end(), nThis);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitIdNode(IdNode *node)
+int DumpDotVisitor::visitIdNode(IdNode *node)
 {
 	int nThis = dumper->newNode(1, node->name->c_str());
-	pending.insert(pending.end(), nThis);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitArrayItemNode(ArrayItemNode *node)
+int DumpDotVisitor::visitArrayItemNode(ArrayItemNode *node)
 {
+	int nArray = visit(node->array);
 	int nThis = dumper->newNode(4, " ", "\\[", " ", "\\]");
 
-	int nArray = pending.back();
-	pending.pop_back();
-
 	dumper->drawLine(nThis, 0, nArray);
-	int length = node->index->nodes.size();
-	dumpList(length, nThis, 2);
+	dumpList(node->index->nodes, nThis, 2);
 
-	pending.insert(pending.end(), nThis);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitStructItemNode(StructItemNode *node)
+int DumpDotVisitor::visitStructItemNode(StructItemNode *node)
 {
+	int nStru = visit(node->stru);
 	int nThis;
 	if (node->isPointer)
 		nThis = dumper->newNode(3, " ", "-\\>", node->itemName->c_str());
 	else
 		nThis = dumper->newNode(3, " ", ".", node->itemName->c_str());
-	int nStru = pending.back();
-	pending.pop_back();
 	dumper->drawLine(nThis, 0, nStru);
-	pending.insert(pending.end(), nThis);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitFunCallNode(FunCallNode *node)
+int DumpDotVisitor::visitFunCallNode(FunCallNode *node)
 {
+	int nFunc = visit(node->func);
 	int nThis = dumper->newNode(4, " ", "\\(", " ", "\\)");
-	int nFunc = pending.back();
-	pending.pop_back();
 	dumper->drawLine(nThis, 0, nFunc);
-	if (node->hasArgs) {
-		int length = node->argv->nodes.size();
-		dumpList(length, nThis, 2);
-	}
-	pending.insert(pending.end(), nThis);
+	if (node->hasArgs)
+		dumpList(node->argv->nodes, nThis, 2);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitIdVarDefNode(IdVarDefNode *node)
+int DumpDotVisitor::visitIdVarDefNode(IdVarDefNode *node)
 {
 	int nThis = 0;
 	if (node->isAssigned) {
+		int nValue = visit(node->value);
 		nThis = dumper->newNode(3, node->name->c_str(), "=", " ");
-		int nValue = pending.back();
-		pending.pop_back();
 		dumper->drawLine(nThis, 2, nValue);
 	}
 	else {
 		nThis = dumper->newNode(1, node->name->c_str());
 	}
-	pending.insert(pending.end(), nThis);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitArrayVarDefNode(ArrayVarDefNode *node)
+int DumpDotVisitor::visitArrayVarDefNode(ArrayVarDefNode *node)
 {
 	int nThis = 0;
 	if (node->isAssigned) {
 		nThis = dumper->newNode(8, node->name->c_str(), "\\[", " ", "\\]", "=", "\\{", " ", "\\}");
-
-		int length = node->values->nodes.size();
-		dumpList(length, nThis, 6);
+		dumpList(node->values->nodes, nThis, 6);
 	}
 	else {
 		nThis = dumper->newNode(4, node->name->c_str(), "\\[", " ", "\\]");
 	}
-	pending.insert(pending.end(), nThis);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitEmptyNode(EmptyNode *node)
+int DumpDotVisitor::visitEmptyNode(EmptyNode *node)
 {
 	int nThis = dumper->newNode(1, "empty");
-	pending.insert(pending.end(), nThis);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitBlockNode(BlockNode *node)
+int DumpDotVisitor::visitBlockNode(BlockNode *node)
 {
 	int nThis = dumper->newNode(3, "\\{", " ", "\\}");
-	int length = node->blockItems->nodes.size();
-	dumpList(length, nThis, 1);
-	pending.insert(pending.end(), nThis);
+	dumpList(node->blockItems->nodes, nThis, 1);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitVarDeclNode(VarDeclNode *node)
+int DumpDotVisitor::visitVarDeclNode(VarDeclNode *node)
 {
 	string typeStr;
 	switch (node->valueTy.type) {
@@ -213,39 +198,44 @@ void DumpDotVisitor::visitVarDeclNode(VarDeclNode *node)
 		break;
 	}
 	int nThis = dumper->newNode(2, typeStr.c_str(), " ");
-	int length = node->defList->nodes.size();
-	dumpList(length, nThis, 1);
-	pending.insert(pending.end(), nThis);
+	dumpList(node->defList->nodes, nThis, 1);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitAssignStmtNode(AssignStmtNode *node)
+int DumpDotVisitor::visitAssignStmtNode(AssignStmtNode *node)
 {
-	int nThis = dumper->newNode(3, " ", "=", " ");
-
-	int nExp = pending.back();
-	pending.pop_back();
-	int nLVal = pending.back();
-	pending.pop_back();
+	char st[3] = " =";
+	st[0] = node->op;
+	int nLVal = visit(node->lval);
+	int nExp = visit(node->exp);
+	int nThis = dumper->newNode(3, " ", node->op == '=' ? "=" : st, " ");
 
 	dumper->drawLine(nThis, 0, nLVal);
 	dumper->drawLine(nThis, 2, nExp);
-	pending.insert(pending.end(), nThis);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitFunCallStmtNode(FunCallStmtNode *node)
+int DumpDotVisitor::visitFunCallStmtNode(FunCallStmtNode *node)
 {
+	return visit(node->funCall);
 }
 
 
-void DumpDotVisitor::visitBlockStmtNode(BlockStmtNode *node)
+int DumpDotVisitor::visitBlockStmtNode(BlockStmtNode *node)
 {
+	return visit(node->block);
 }
 
 
-void DumpDotVisitor::visitCondNode(CondNode *node)
+int DumpDotVisitor::visitCondNode(CondNode *node)
 {
+	int nLhs = 0;
+	if (node->op != NOT_OP)
+		nLhs = visit(node->lhs);
+	int nRhs = visit(node->rhs);
+
 	char op_str[4] = "   ";
 	char op = node->op;
 	switch (op) {
@@ -294,162 +284,127 @@ void DumpDotVisitor::visitCondNode(CondNode *node)
 	}
 	int nThis = dumper->newNode(3, " ", op_str, " ");
 
-	int nRhs = pending.back();
-	pending.pop_back();
 	dumper->drawLine(nThis, 2, nRhs);
 
-	if (op != NOT_OP) {
-		int nLhs = pending.back();
-		pending.pop_back();
+	if (op != NOT_OP)
 		dumper->drawLine(nThis, 0, nLhs);
-	}
 
-	pending.insert(pending.end(), nThis);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitIfStmtNode(IfStmtNode *node)
+int DumpDotVisitor::visitIfStmtNode(IfStmtNode *node)
 {
 	int nThis = 0;
-		if (node->hasElse) {
-			nThis = dumper->newNode(6, "if", " ", "then", " ", "else", " ");
-
-			int nElse = pending.back();
-			pending.pop_back();
-			int nThen = pending.back();
-			pending.pop_back();
-			int nCond = pending.back();
-			pending.pop_back();
-
-			dumper->drawLine(nThis, 1, nCond);
-			dumper->drawLine(nThis, 3, nThen);
-			dumper->drawLine(nThis, 5, nElse);
-		}
-		else {
-			nThis = dumper->newNode(4, "if", " ", "then", " ");
-
-			int nThen = pending.back();
-			pending.pop_back();
-			int nCond = pending.back();
-			pending.pop_back();
+	int nCond = visit(node->cond);
+	int nThen = visit(node->then_stmt);
+	if (node->hasElse) {
+		int nElse = visit(node->else_stmt);
+		nThis = dumper->newNode(6, "if", " ", "then", " ", "else", " ");
+
+		dumper->drawLine(nThis, 1, nCond);
+		dumper->drawLine(nThis, 3, nThen);
+		dumper->drawLine(nThis, 5, nElse);
+	}
+	else {
+		nThis = dumper->newNode(4, "if", " ", "then", " ");
 
-			dumper->drawLine(nThis, 1, nCond);
-			dumper->drawLine(nThis, 3, nThen);
-		}
-	pending.insert(pending.end(), nThis);
+		dumper->drawLine(nThis, 1, nCond);
+		dumper->drawLine(nThis, 3, nThen);
+	}
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitWhileStmtNdoe(WhileStmtNode *node)
+int DumpDotVisitor::visitWhileStmtNdoe(WhileStmtNode *node)
 {
+	int nCond = visit(node->cond);
+	int nDo = visit(node->do_stmt);
 	int nThis = dumper->newNode(3, "while", " ", " ");
 
-	int nDo = pending.back();
-	pending.pop_back();
-	int nCond = pending.back();
-	pending.pop_back();
-
 	dumper->drawLine(nThis, 1, nCond);
 	dumper->drawLine(nThis, 2, nDo);
-	pending.insert(pending.end(), nThis);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitReturnStmtNdoe(ReturnStmtNode *node)
+int DumpDotVisitor::visitForStmtNode(ForStmtNode *node)
 {
-	int nThis = dumper->newNode(2, "return", " ");
+	int nThis = dumper->newNode(5, "for", " ", " ", " ", " ");
 
-	int nExp  = pending.back();
-	pending.pop_back();
+	if (node->hasInit)
+		dumper->drawLine(nThis, 1, visit(node->init));
+	if (node->hasCond)
+		dumper->drawLine(nThis, 2, visit(node->cond));
+	if (node->hasStep)
+		dumper->drawLine(nThis, 3, visit(node->step));
+	dumper->drawLine(nThis, 4, visit(node->do_stmt));
+	return nThis;
+}
+
+
+int DumpDotVisitor::visitReturnStmtNdoe(ReturnStmtNode *node)
+{
+	if (!node->hasExp)
+		return dumper->newNode(1, "return");
+
+	int nExp = visit(node->exp);
+	int nThis = dumper->newNode(2, "return", " ");
 
 	dumper->drawLine(nThis, 1, nExp);
-	pending.insert(pending.end(), nThis);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitBreakStmtNode(BreakStmtNode *node)
+int DumpDotVisitor::visitBreakStmtNode(BreakStmtNode *node)
 {
 	int nThis = dumper->newNode(1, "break");
-	pending.insert(pending.end(), nThis);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitContinueStmtNode(ContinueStmtNode *node)
+int DumpDotVisitor::visitContinueStmtNode(ContinueStmtNode *node)
 {
 	int nThis = dumper->newNode(1, "continue");
-	pending.insert(pending.end(), nThis);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitFuncDeclNode(FuncDeclNode *node)
+int DumpDotVisitor::visitFuncDeclNode(FuncDeclNode *node)
 {
 	int nThis = dumper->newNode(5, "void", node->name->c_str(), "\\(", " ", "\\)");
-	if (node->hasArgs) {
-		NodeList *argv = node->valueTy.argv;
-		argv->accept(*this);
-		int length = argv->nodes.size();
-		dumpList(length, nThis, 3);
-	}
-	pending.insert(pending.end(), nThis);
+	if (node->hasArgs)
+		dumpList(node->valueTy.argv->nodes, nThis, 3);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitFuncDefNode(FuncDefNode *node)
+int DumpDotVisitor::visitFuncDefNode(FuncDefNode *node)
 {
+	int nDecl = visit(node->decl);
+	int nBlock = visit(node->block);
 	int nThis = dumper->newNode(2, "definition", "body");
 
-	int nBlock = pending.back();
-	pending.pop_back();
-	int nDecl = pending.back();
-	pending.pop_back();
-
 	dumper->drawLine(nThis, 0, nDecl);
 	dumper->drawLine(nThis, 1, nBlock);
 
-	pending.insert(pending.end(), nThis);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitStructDefNode(StructDefNode *node)
+int DumpDotVisitor::visitStructDefNode(StructDefNode *node)
 {
 	int nThis = dumper->newNode(3, "struct", node->name->c_str(), "\\{ \\}");
-	int length = node->decls->nodes.size();
-	dumpList(length, nThis, 2);
-	pending.insert(pending.end(), nThis);
+	dumpList(node->decls->nodes, nThis, 2);
+	return nThis;
 }
 
 
-void DumpDotVisitor::visitCompUnitNode(CompUnitNode *node)
+int DumpDotVisitor::visitCompUnitNode(CompUnitNode *node)
 {
 	int nThis = dumper->newNode(1, "CompUnit");
-	int length = node->nodes.size();
-	dumpList(length, nThis, 0);
-	pending.insert(pending.end(), nThis);
-}
-
-
-void DumpDotVisitor::enterBlockNode(BlockNode *node)
-{
-}
-
-
-void DumpDotVisitor::enterIfStmtNode(IfStmtNode *node)
-{
-}
-
-
-void DumpDotVisitor::enterWhileStmtNode(WhileStmtNode *node)
-{
-}
-
-
-void DumpDotVisitor::enterFuncDefNode(FuncDefNode *node)
-{
-}
-
-
-void DumpDotVisitor::enterStructDefNode(StructDefNode *node)
-{
+	dumpList(node->nodes, nThis, 0);
+	return nThis;
 }
 
 
@@ -0,0 +1,562 @@
+#include <map>
+#include <set>
+#include <list>
+
+#include "effect_visitor.h"
+#include "node.h"
+
+
+using namespace std;
+
+
+EffectVisitor::EffectVisitor(const TypeTable &types)
+	: types(types)
+{
+	deps = NULL;
+	cur = NULL;
+	owner = NULL;
+}
+
+
+EffectVisitor::~EffectVisitor()
+{
+	// empty
+}
+
+
+void EffectVisitor::setDepGraph(const DepGraph *deps)
+{
+	this->deps = deps;
+}
+
+
+// functions without a body here may do anything
+MemEffect EffectVisitor::memEffect(const FuncDeclNode *func) const
+{
+	map<const FuncDeclNode *, FuncEffects>::const_iterator it = funcs.find(func);
+	if (it == funcs.end())
+		return WRITE_MEM;
+	return it->second.mem;
+}
+
+
+bool EffectVisitor::argNoCapture(const Node *arg) const
+{
+	map<const Node *, int>::const_iterator it = args.find(arg);
+	return it != args.end() && !(it->second & ARG_CAPTURED);
+}
+
+
+bool EffectVisitor::argReadOnly(const Node *arg) const
+{
+	map<const Node *, int>::const_iterator it = args.find(arg);
+	return it != args.end() && it->second == 0;
+}
+
+
+bool EffectVisitor::isLive(const Node *decl) const
+{
+	return live.count(decl) != 0;
+}
+
+
+void EffectVisitor::note(MemEffect mem)
+{
+	if (cur != NULL && mem > cur->mem)
+		cur->mem = mem;
+}
+
+
+// the function or global initializer being walked refers to decl
+void EffectVisitor::refer(const Node *decl)
+{
+	if (owner != NULL && (globals.count(decl) || decl->type == FUNC_DECL_AST))
+		refs[owner].insert(decl);
+}
+
+
+void EffectVisitor::markLive(const Node *decl)
+{
+	list<const Node *> work;
+	work.push_back(decl);
+
+	while (!work.empty()) {
+		const Node *item = work.front();
+		work.pop_front();
+		if (!live.insert(item).second)
+			continue;
+
+		set<const Node *> &used = refs[item];
+		for (set<const Node *>::iterator it = used.begin(); it != used.end(); it++)
+			work.push_back(*it);
+	}
+}
+
+
+bool EffectVisitor::isPointerArg(const Node *decl) const
+{
+	return args.find(decl) != args.end();
+}
+
+
+// the memory at loc is read or written
+void EffectVisitor::access(Node *loc, bool write)
+{
+	switch (loc->type) {
+	case ID_AST:
+	{
+		const Node *decl = types.declOf((IdNode *)loc);
+		if (decl == NULL)
+			return;
+		refer(decl);
+
+		// array and struct arguments are passed by address
+		ValueType type = types[decl].type;
+		if (isPointerArg(decl) && (type == ARRAY_TYPE || type == STRUCT_TYPE)) {
+			note(write ? WRITE_MEM : READ_MEM);
+			if (write)
+				args[decl] |= ARG_WRITTEN;
+		}
+		else if (globals.count(decl))
+			note(write ? WRITE_MEM : READ_MEM);
+		return;
+	}
+	case ARRAY_ITEM_AST:
+	{
+		ArrayItemNode *item = (ArrayItemNode *)loc;
+		visit(item->index);
+		access(item->array, write);
+		return;
+	}
+	case STRUCT_ITEM_AST:
+	{
+		StructItemNode *item = (StructItemNode *)loc;
+		if (item->isPointer)
+			deref(item->stru, write);
+		else
+			access(item->stru, write);
+		return;
+	}
+	case UNARY_EXP_AST:
+		if (((UnaryExpNode *)loc)->op == '*') {
+			deref(((UnaryExpNode *)loc)->operand, write);
+			return;
+		}
+		break;
+	default:
+		break;
+	}
+
+	// not a variable, e.g. a call returning a struct
+	visit(loc);
+}
+
+
+// the memory ptr points to is read or written
+void EffectVisitor::deref(Node *ptr, bool write)
+{
+	note(write ? WRITE_MEM : READ_MEM);
+
+	if (ptr->type == ID_AST) {
+		const Node *decl = types.declOf((IdNode *)ptr);
+		if (decl != NULL && isPointerArg(decl)) {
+			if (write)
+				args[decl] |= ARG_WRITTEN;
+			return;
+		}
+	}
+	visit(ptr);
+}
+
+
+// the address of loc is taken, an argument it is based on escapes
+void EffectVisitor::addressOf(Node *loc)
+{
+	switch (loc->type) {
+	case ID_AST:
+	{
+		const Node *decl = types.declOf((IdNode *)loc);
+		if (decl == NULL)
+			return;
+		refer(decl);
+		if (isPointerArg(decl))
+			args[decl] |= ARG_CAPTURED;
+		return;
+	}
+	case ARRAY_ITEM_AST:
+		visit(((ArrayItemNode *)loc)->index);
+		addressOf(((ArrayItemNode *)loc)->array);
+		return;
+	case STRUCT_ITEM_AST:
+		if (((StructItemNode *)loc)->isPointer)
+			visit(((StructItemNode *)loc)->stru);
+		else
+			addressOf(((StructItemNode *)loc)->stru);
+		return;
+	case UNARY_EXP_AST:
+		if (((UnaryExpNode *)loc)->op == '*') {
+			visit(((UnaryExpNode *)loc)->operand);
+			return;
+		}
+		break;
+	default:
+		break;
+	}
+	visit(loc);
+}
+
+
+void EffectVisitor::visitNodeList(NodeList *node)
+{
+	for (list<Node *>::iterator it = node->nodes.begin();
+			it != node->nodes.end(); it++) {
+		visit(*it);
+	}
+}
+
+
+void EffectVisitor::visitNumNode(NumNode *node)
+{
+	// empty
+}
+
+
+void EffectVisitor::visitFNumNode(FNumNode *node)
+{
+	// empty
+}
+
+
+void EffectVisitor::visitCharNode(CharNode *node)
+{
+	// empty
+}
+
+
+void EffectVisitor::visitBinaryExpNode(BinaryExpNode *node)
+{
+	if (types[node].isComputed)
+		return;
+	visit(node->lhs);
+	visit(node->rhs);
+}
+
+
+void EffectVisitor::visitUnaryExpNode(UnaryExpNode *node)
+{
+	if (types[node].isComputed)
+		return;
+
+	switch (node->op) {
+	case '*':
+		deref(node->operand, false);
+		break;
+	case '&':
+		addressOf(node->operand);
+		break;
+	default:
+		visit(node->operand);
+		break;
+	}
+}
+
+
+// the value of a variable is used
+void EffectVisitor::visitIdNode(IdNode *node)
+{
+	if (types[node].isComputed)
+		return;
+
+	const Node *decl = types.declOf(node);
+	if (decl == NULL)
+		return;
+	refer(decl);
+
+	// a pointer argument used as a value may be kept anywhere
+	if (isPointerArg(decl))
+		args[decl] |= ARG_CAPTURED;
+	// a global array is used by its address, anything else is loaded
+	else if (globals.count(decl) && types[node].type != ARRAY_TYPE)
+		note(READ_MEM);
+}
+
+
+void EffectVisitor::visitArrayItemNode(ArrayItemNode *node)
+{
+	if (types[node].isComputed)
+		return;
+	access(node, false);
+}
+
+
+void EffectVisitor::visitStructItemNode(StructItemNode *node)
+{
+	access(node, false);
+}
+
+
+void EffectVisitor::visitFunCallNode(FunCallNode *node)
+{
+	if (node->hasArgs)
+		visit(node->argv);
+
+	const Node *decl = NULL;
+	if (node->func->type == ID_AST)
+		decl = types.declOf((IdNode *)node->func);
+
+	if (decl != NULL && decl->type == FUNC_DECL_AST) {
+		refer(decl);
+		if (cur != NULL)
+			cur->callees.insert((const FuncDeclNode *)decl);
+	}
+	else {
+		// through a function pointer
+		note(WRITE_MEM);
+		visit(node->func);
+	}
+}
+
+
+void EffectVisitor::visitIdVarDefNode(IdVarDefNode *node)
+{
+	if (node->isAssigned)
+		visit(node->value);
+}
+
+
+void EffectVisitor::visitArrayVarDefNode(ArrayVarDefNode *node)
+{
+	if (node->isAssigned)
+		visit(node->values);
+}
+
+
+void EffectVisitor::visitEmptyNode(EmptyNode *node)
+{
+	// empty
+}
+
+
+void EffectVisitor::visitBlockNode(BlockNode *node)
+{
+	list<Node *> &items = node->blockItems->nodes;
+	for (list<Node *>::iterator it = items.begin(); it != items.end(); it++) {
+		if (!types.pruned(*it))
+			visit(*it);
+	}
+}
+
+
+void EffectVisitor::visitVarDeclNode(VarDeclNode *node)
+{
+	visit(node->defList);
+}
+
+
+void EffectVisitor::visitAssignStmtNode(AssignStmtNode *node)
+{
+	visit(node->exp);
+	if (node->op != '=')
+		access(node->lval, false);
+	access(node->lval, true);
+}
+
+
+void EffectVisitor::visitFunCallStmtNode(FunCallStmtNode *node)
+{
+	visit(node->funCall);
+}
+
+
+void EffectVisitor::visitBlockStmtNode(BlockStmtNode *node)
+{
+	visit(node->block);
+}
+
+
+void EffectVisitor::visitCondNode(CondNode *node)
+{
+	if (types[node].isComputed)
+		return;
+	if (node->op != NOT_OP)
+		visit(node->lhs);
+	visit(node->rhs);
+}
+
+
+void EffectVisitor::visitIfStmtNode(IfStmtNode *node)
+{
+	visit(node->cond);
+	if (!types.pruned(node->then_stmt))
+		visit(node->then_stmt);
+	if (node->hasElse && !types.pruned(node->else_stmt))
+		visit(node->else_stmt);
+}
+
+
+void EffectVisitor::visitWhileStmtNdoe(WhileStmtNode *node)
+{
+	visit(node->cond);
+	if (!types.pruned(node->do_stmt))
+		visit(node->do_stmt);
+}
+
+
+void EffectVisitor::visitForStmtNode(ForStmtNode *node)
+{
+	if (node->hasInit)
+		visit(node->init);
+	if (node->hasCond)
+		visit(node->cond);
+	if (!types.pruned(node->do_stmt)) {
+		if (node->hasStep)
+			visit(node->step);
+		visit(node->do_stmt);
+	}
+}
+
+
+void EffectVisitor::visitReturnStmtNdoe(ReturnStmtNode *node)
+{
+	if (node->hasExp)
+		visit(node->exp);
+}
+
+
+void EffectVisitor::visitBreakStmtNode(BreakStmtNode *node)
+{
+	// empty
+}
+
+
+void EffectVisitor::visitContinueStmtNode(ContinueStmtNode *node)
+{
+	// empty
+}
+
+
+void EffectVisitor::visitFuncDeclNode(FuncDeclNode *node)
+{
+	// empty
+}
+
+
+void EffectVisitor::visitFuncDefNode(FuncDefNode *node)
+{
+	FuncEffects &effects = funcs[node->decl];
+	effects.mem = NO_MEM;
+
+	// a kept body refers to what it used last time
+	if (deps != NULL && deps->reusable(node)) {
+		effects.mem = WRITE_MEM;
+		const set<string> &uses = deps->item(deps->itemOf(node)).bodyUses;
+		for (set<string>::const_iterator it = uses.begin(); it != uses.end(); it++) {
+			map<string, const Node *>::iterator top = tops.find(*it);
+			if (top != tops.end())
+				refs[node->decl].insert(top->second);
+		}
+		return;
+	}
+
+	// a struct result is written to the caller's memory, or copied there
+	// from the registers it comes back in
+	if (types[node->decl].atom->type == STRUCT_TYPE)
+		effects.mem = WRITE_MEM;
+
+	// arrays and structs are passed by address as well
+	if (node->decl->hasArgs) {
+		list<Node *> &argNodes = types[node->decl].argv->nodes;
+		for (list<Node *>::iterator it = argNodes.begin(); it != argNodes.end(); it++) {
+			ValueType type = types[*it].type;
+			if (type == PTR_TYPE || type == ARRAY_TYPE || type == STRUCT_TYPE)
+				args[*it] = 0;
+		}
+	}
+
+	cur = &effects;
+	owner = node->decl;
+	visit(node->block);
+	owner = NULL;
+	cur = NULL;
+}
+
+
+void EffectVisitor::visitStructDefNode(StructDefNode *node)
+{
+	// empty
+}
+
+
+void EffectVisitor::visitCompUnitNode(CompUnitNode *node)
+{
+	const Node *mainFunc = NULL;
+
+	// every global is known before the first body refers to it
+	for (list<Node *>::iterator it = node->nodes.begin();
+			it != node->nodes.end(); it++) {
+		if ((*it)->type == VAR_DECL_AST) {
+			list<Node *> &defs = ((VarDeclNode *)(*it))->defList->nodes;
+			for (list<Node *>::iterator defIt = defs.begin(); defIt != defs.end(); defIt++) {
+				if ((*defIt)->type == ID_VAR_DEF_AST || (*defIt)->type == ARRAY_VAR_DEF_AST) {
+					globals.insert(*defIt);
+					tops[*((VarDefNode *)(*defIt))->name] = *defIt;
+				}
+				else if ((*defIt)->type == FUNC_DECL_AST)
+					tops[*((FuncDeclNode *)(*defIt))->name] = *defIt;
+			}
+		}
+		else if ((*it)->type == FUNC_DEF_AST) {
+			FuncDeclNode *decl = ((FuncDefNode *)(*it))->decl;
+			tops[*decl->name] = decl;
+			if (*decl->name == "main")
+				mainFunc = decl;
+		}
+	}
+
+	for (list<Node *>::iterator it = node->nodes.begin();
+			it != node->nodes.end(); it++) {
+		if ((*it)->type == VAR_DECL_AST) {
+			// initializers may take the address of a global or a function
+			list<Node *> &defs = ((VarDeclNode *)(*it))->defList->nodes;
+			for (list<Node *>::iterator defIt = defs.begin(); defIt != defs.end(); defIt++) {
+				owner = *defIt;
+				visit(*defIt);
+			}
+			owner = NULL;
+		}
+		else if ((*it)->type == FUNC_DEF_AST)
+			visit(*it);
+	}
+
+	// what is reached from outside the file
+	if (mainFunc != NULL)
+		markLive(mainFunc);
+	else {
+		for (map<string, const Node *>::iterator it = tops.begin(); it != tops.end(); it++) {
+			const Node *decl = it->second;
+			if (globals.count(decl) && (types[decl].isStatic || types[decl].isExtern))
+				continue;
+			if (decl->type == FUNC_DECL_AST && funcs.find((const FuncDeclNode *)decl) == funcs.end())
+				continue;
+			markLive(decl);
+		}
+	}
+
+	// a function does what its callees do, around cycles too
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (map<const FuncDeclNode *, FuncEffects>::iterator it = funcs.begin();
+				it != funcs.end(); it++) {
+			FuncEffects &effects = it->second;
+			for (set<const FuncDeclNode *>::iterator calleeIt = effects.callees.begin();
+					calleeIt != effects.callees.end(); calleeIt++) {
+				MemEffect mem = memEffect(*calleeIt);
+				if (mem > effects.mem) {
+					effects.mem = mem;
+					changed = true;
+				}
+			}
+		}
+	}
+}
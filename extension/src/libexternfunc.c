@@ -31,3 +31,73 @@ void print_float(float f)
 {
 	printf("%.2f", f);
 }
+
+// Structs going to and coming back from a C1 program, to check that both
+// sides pass them the same way.
+struct abi_pair {
+	int a;
+	int b;
+};
+
+struct abi_mixed {
+	int id;
+	float score;
+	char tag;
+};
+
+struct abi_floats {
+	float x;
+	float y;
+	float z;
+};
+
+struct abi_big {
+	int v[5];
+};
+
+struct abi_pair abi_swap(struct abi_pair p)
+{
+	struct abi_pair r = {p.b, p.a};
+	return r;
+}
+
+struct abi_mixed abi_next(struct abi_mixed m)
+{
+	m.id++;
+	m.score *= 2;
+	m.tag++;
+	return m;
+}
+
+struct abi_floats abi_scale(struct abi_floats f, float k)
+{
+	f.x *= k;
+	f.y *= k;
+	f.z *= k;
+	return f;
+}
+
+struct abi_big abi_reverse(struct abi_big b)
+{
+	struct abi_big r;
+	int i;
+	for (i = 0; i < 5; i++)
+		r.v[i] = b.v[4 - i];
+	return r;
+}
+
+// the six general registers are taken, p goes on the stack
+int abi_last(int a, int b, int c, int d, int e, int f, struct abi_pair p)
+{
+	return a + b + c + d + e + f + p.a * 100 + p.b * 1000;
+}
+
+// calls back into the program, which has to take and return the structs
+// the way C does
+void abi_callback(struct abi_mixed (*f)(struct abi_mixed m, struct abi_floats g))
+{
+	struct abi_mixed m = {7, 1.5f, 'p'};
+	struct abi_floats g = {0.25f, 0.5f, 0.75f};
+	struct abi_mixed r = f(m, g);
+	printf("%d %.2f %c", r.id, r.score, r.tag);
+}
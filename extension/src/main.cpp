@@ -1,5 +1,7 @@
 #include <cstdio>
+#include <cstring>
 #include <string>
+#include <getopt.h>
 #include "msgfactory.h"
 #include "node.h"
 #include "tok.h"
@@ -8,12 +10,18 @@
 #include "dumpdot_visitor.h"
 #include "codegen_visitor.h"
 #include "check_visitor.h"
+#include "simplify_visitor.h"
+#include "effect_visitor.h"
+#include "type_table.h"
+#include "dep_graph.h"
 
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/SourceMgr.h"
 
 #include "llvm/Analysis/Passes.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
@@ -34,6 +42,9 @@ CompUnitNode *root; // AST's root, shared with yyparse()
 list<Node*> astNodes;
 bool errorFlag = false;
 bool typeDebugFlag = false;
+bool fusedFlag = false;
+bool incrementalFlag = false;
+int repeatCount = 0;
 
 MsgFactory msgFactory;
 
@@ -41,25 +52,114 @@ llvm::Module *TheModule;
 llvm::ExecutionEngine *TheExecutionEngine;
 llvm::FunctionPassManager *TheFPM;
 
-int main(int argc, char** argv)
+// the whole input, the dependency graph hashes it item by item
+static std::string readSource(FILE *fp)
 {
-    if (handle_opt(argc, argv) == false)
-        return 0;
+    std::string source;
+    char buffer[4096];
+    size_t n;
+
+    fseek(fp, 0, SEEK_SET);
+    while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        source.append(buffer, n);
+    return source;
+}
+
+// resident set size in pages, -1 if it cannot be read
+static long residentPages()
+{
+    long size, resident;
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (fp == NULL)
+        return -1;
+    if (fscanf(fp, "%ld %ld", &size, &resident) != 2)
+        resident = -1;
+    fclose(fp);
+    return resident;
+}
+
+// compile infp once; everything allocated for it is released at the end, so
+// this can run any number of times in one process
+static void compile(bool report)
+{
+    errorFlag = false;
+    rewind(infp);
     yyin = infp;        // infp is initialized in handle_opt()
     yyparse();
 
+    // types and constants found by the checker, the AST itself stays as parsed
+    TypeTable types(nodeIdBound());
+
+    // the fused mode checks and emits each top-level item in turn, it is only
+    // used when no type listing or DOT dump of the whole checked tree is asked for
+    bool fused = fusedFlag && !typeDebugFlag && dumpfp == NULL;
+
+    std::string inFileStr = string(infile_name);
+    std::string baseName = inFileStr.
+    								substr(inFileStr.find("/") + 1, inFileStr.rfind('.') - inFileStr.find("/") - 1);
+    std::string ll_file_name = baseName + string(".ll");
+    std::string deps_file_name = baseName + string(".deps");
+
+    // the incremental mode keeps the function bodies that did not change
+    // since the last compilation of this file, taken from the .ll it wrote,
+    // see dep_graph.h; it needs a whole file and the two-pass mode
+    bool incremental = incrementalFlag && !fused && !typeDebugFlag && dumpfp == NULL
+    		&& infp != stdin;
+    DepGraph deps;
+    std::unique_ptr<llvm::Module> prevModule;
+    if (incremental && !errorFlag) {
+    	DepGraph prevDeps;
+    	llvm::SMDiagnostic err;
+
+    	deps.build(root, readSource(infp));
+    	if (prevDeps.load(deps_file_name.c_str()))
+    		prevModule = llvm::parseIRFile(ll_file_name, err, llvm::getGlobalContext());
+    	if (prevModule) {
+    		deps.compare(prevDeps);
+    		for (int i = 0; i < deps.size(); i++) {
+    			llvm::Function *F = prevModule->getFunction(deps.item(i).name);
+    			if (deps.item(i).reuse && (F == NULL || F->isDeclaration()))
+    				deps.dontReuse(i);
+    		}
+
+    		// free the struct names for the new module
+    		std::vector<llvm::StructType *> structs = prevModule->getIdentifiedStructTypes();
+    		for (std::vector<llvm::StructType *>::iterator it = structs.begin();
+    				it != structs.end(); it++)
+    			(*it)->setName("prev." + (*it)->getName().str());
+    	}
+    }
+
     // type check
-    if (!errorFlag) {
-    	CheckVisitor checkVisitor;
+    if (!errorFlag && !fused) {
+    	CheckVisitor checkVisitor(types, msgFactory);
     	if (typeDebugFlag)
     		checkVisitor.setDebug();
-    	root->accept(checkVisitor);
+    	if (incremental)
+    		checkVisitor.setDepGraph(&deps);
+    	checkVisitor.visit(root);
+    	if (checkVisitor.failed())
+    		errorFlag = true;
+    }
+
+    // prune what can never run, before anything else looks at the bodies
+    if (!errorFlag && !fused) {
+    	SimplifyVisitor simplifyVisitor(types, msgFactory);
+    	simplifyVisitor.visit(root);
+    }
+
+    // side effects of the functions, for the attributes codegen puts on them
+    EffectVisitor effects(types);
+    if (!errorFlag && !fused) {
+    	if (incremental)
+    		effects.setDepGraph(&deps);
+    	effects.visit(root);
     }
 
     // dump DOT
     if (dumpfp != NULL && !errorFlag) {
         DumpDotVisitor dumpVisitor(dumpfp);
-        root->accept(dumpVisitor);
+        dumpVisitor.visit(root);
     }
 
     // codegen
@@ -67,10 +167,6 @@ int main(int argc, char** argv)
     llvm::InitializeNativeTargetAsmPrinter();
     llvm::InitializeNativeTargetAsmParser();
 
-    std::string inFileStr = string(infile_name);
-    std::string ll_file_name = inFileStr.
-    								substr(inFileStr.find("/") + 1, inFileStr.rfind('.') - inFileStr.find("/") - 1)
-									+ string(".ll");
     llvm::LLVMContext &Context = llvm::getGlobalContext();
     std::unique_ptr<llvm::Module> Owner = llvm::make_unique<llvm::Module>("Yao Kai's compiler !!!", Context);
     TheModule = Owner.get();
@@ -112,26 +208,128 @@ int main(int argc, char** argv)
 
     if (!errorFlag) {
 //    if (false) {
-    	CodegenVisitor codegenVisitor(ll_file_name);
-    	root->accept(codegenVisitor);
+    	CodegenVisitor codegenVisitor(ll_file_name, types);
+    	if (prevModule)
+    		codegenVisitor.reuseBodies(&deps, prevModule.get());
+    	if (fused) {
+    		// codegen finds names through the bindings the checker records in
+    		// types, so the checker's scoped table is the only one.  Simplify
+    		// runs on each body in between; its warnings are kept apart and
+    		// dropped on an error, as the two-pass mode never gets to them.
+    		// The effect analysis needs every body first and is left out, see
+    		// the -f paragraph of the design document.
+    		CheckVisitor checkVisitor(types, msgFactory);
+    		MsgFactory simplifyMsgs;
+    		SimplifyVisitor simplifyVisitor(types, simplifyMsgs);
+    		for (list<Node *>::iterator it = root->nodes.begin();
+    				it != root->nodes.end() && !errorFlag; it++) {
+    			checkVisitor.visit(*it);
+    			if (checkVisitor.failed())
+    				errorFlag = true;
+    			if (errorFlag)
+    				break;
+    			if ((*it)->type == FUNC_DEF_AST)
+    				simplifyVisitor.visit(*it);
+    			codegenVisitor.visit(*it);
+    		}
+    		if (!errorFlag)
+    			msgFactory.merge(simplifyMsgs);
+    	}
+    	else {
+    		codegenVisitor.setEffects(&effects);
+    		codegenVisitor.visit(root);
+    	}
 
 		if (!errorFlag) {
 			freopen(ll_file_name.c_str(), "w", stderr);
 			codegenVisitor.dump();
+			if (incremental)
+				deps.save(deps_file_name.c_str());
 		}
     }
+    prevModule.reset();
     // end codegen
 
     // messages
-    msgFactory.summary();
-    printf("\n");
+    if (report) {
+    	msgFactory.summary();
+    	printf("\n");
+    }
 
 	yylex_destroy();
 	clearAstNodes();
 
+	// the execution engine owns TheModule
+	delete TheExecutionEngine;
+}
+
+// make name the file compile() reads
+static bool openInput(const char *name)
+{
+    FILE *fp = fopen(name, "r");
+    if (fp == NULL) {
+    	printf("Can not open infile %s\n", name);
+    	return false;
+    }
+    fclose(infp);
+    infp = fp;
+    strcpy(infile_name, name);
+    return true;
+}
+
+// -r: compile the files n times over, in turn, as a host process embedding
+// the compiler would, and fail if memory keeps growing.  The first tenth of
+// the runs warms up the allocator and LLVM's uniqued constants; after that
+// the resident set may only grow by a small slack.  With several files, a
+// compile also sees what the ones before it left in the LLVMContext, e.g.
+// a struct of the same name with other members.
+static bool compileRepeatedly(int n, char **files, int nFiles)
+{
+    const long slackPages = 256;
+    int warmUp = n / 10;
+    long before = -1;
+
+    for (int i = 0; i < n; i++) {
+    	for (int f = 0; f < nFiles; f++) {
+    		if (nFiles > 1 && !openInput(files[f]))
+    			return false;
+    		compile(i == 0);
+    	}
+    	if (i == warmUp)
+    		before = residentPages();
+    }
+    long after = residentPages();
+
+    printf("resident pages after %d compiles: %ld, after %d: %ld\n", warmUp + 1, before, n, after);
+    if (before < 0 || after < 0) {
+    	printf("can not read /proc/self/statm\n");
+    	return false;
+    }
+    if (after - before > slackPages) {
+    	printf("memory grew by %ld pages\n", after - before);
+    	return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (handle_opt(argc, argv) == false)
+        return 0;
+
+    int status = 0;
+    if (repeatCount <= 0)
+    	compile(true);
+    else if (infp == stdin) {
+    	printf("-r needs an input file\n");
+    	status = 1;
+    }
+    else if (!compileRepeatedly(repeatCount, argv + optind, argc - optind))
+    	status = 1;
+
 	fclose(infp);
 	if (dumpfp != NULL)
 		fclose(dumpfp);
 
-    return 0;
+    return status;
 }
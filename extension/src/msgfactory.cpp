@@ -13,6 +13,7 @@ map<int, string> createMsgTable()
 	t[w_miss_int] = string("a type specifier 'int' is required for declarations");
 
 	t[w_type_cast] = string("type cast");
+	t[w_unreachable_code] = string("code will never be executed");
 
 	// errors
 	t[e_rparent] = string("expected ')'");
@@ -33,9 +34,15 @@ map<int, string> createMsgTable()
 	t[e_function_arg_cannot_be_functon] = string("function argument type can't be a function");
 	t[e_not_a_struct] = string("the operand of '.' must be struct type");
 	t[e_no_such_struct] = string("no such struct");
+	t[e_no_such_member] = string("no such member in struct");
 	t[e_array_index_not_int] = string("the index of array should be int type");
 	t[e_does_not_have_address] = string("it doesn't have an address");
 	t[e_not_array_type] = string("'[ ]' operator can only be used in array type");
+	t[e_jump_outside_loop] = string("'break' or 'continue' statement not in loop statement");
+	t[e_return_without_value] = string("non-void function should return a value");
+	t[e_return_value_in_void] = string("void function should not return a value");
+	t[e_excess_initializers] = string("excess elements in array initializer");
+	t[e_redefinition_of_struct] = string("redefinition of struct");
 	return t;
 }
 
@@ -60,57 +67,132 @@ void Warning::show()
 // implementation of method in MsgFactory class
 MsgFactory::MsgFactory()
 {
+	source = NULL;
 }
 
 MsgFactory::~MsgFactory()
 {
-	fclose(source);	
+	if (source != NULL)
+		fclose(source);	
 }
 
 void MsgFactory::initial(const char *fileName)
 {
 	this->fileName = fileName;
 
+	// forget anything left from a previous file
+	if (source != NULL)
+		fclose(source);
+	lineOffset.clear();
+	errors.clear();
+	warnings.clear();
+
 	source = fopen(fileName, "r");
 	if (source == NULL) {
 		fprintf(stdout, "MsgFactory can not open source file %s\n", fileName);
 		return;
 	}
+}
 
-	// record the start location of every line
-	int i = 0;
-	char buffer[500];
-	while (feof(source) == 0) {
-		lineOffset[i++] = ftell(source);
-		fgets(buffer, 500, source);
+// record the start location of every line, only done once a message
+// actually needs a line number
+void MsgFactory::buildLineTable()
+{
+	int c;
+	long offset = 0;
+
+	lineOffset.push_back(0);
+	fseek(source, 0, SEEK_SET);
+	while ((c = fgetc(source)) != EOF) {
+		offset++;
+		if (c == '\n')
+			lineOffset.push_back(offset);
 	}
 	fseek(source, 0, SEEK_SET);
 }
 
-Error MsgFactory::newError(int type, int line, int column)
+void MsgFactory::getLineColumn(SrcLoc loc, int *line, int *column)
 {
-	Error e(type, line, column, fileName);
+	if (lineOffset.empty())
+		buildLineTable();
+
+	// binary search the last line starting at or before loc
+	int lo = 0, hi = lineOffset.size() - 1;
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+		if (lineOffset[mid] <= (long)loc)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	*line = lo + 1;
+	*column = loc - lineOffset[lo] + 1;
+}
+
+Error MsgFactory::newError(int type, SrcLoc loc)
+{
+	Error e(type, loc, fileName);
 	errors.push_back(e);
 	return e;
 }
 
-Warning MsgFactory::newWarning(int type, int line, int column)
+Warning MsgFactory::newWarning(int type, SrcLoc loc)
 {
-	Warning w(type, line, column, fileName);
+	Warning w(type, loc, fileName);
 	warnings.push_back(w);
 	return w;
 }
 
+bool MsgFactory::earlier(const Message &a, const Message &b)
+{
+	return a.loc < b.loc;
+}
+
+void MsgFactory::merge(MsgFactory &other)
+{
+	if (!other.errors.empty()) {
+		errors.splice(errors.end(), other.errors);
+		errors.sort(earlier);
+	}
+	if (!other.warnings.empty()) {
+		warnings.splice(warnings.end(), other.warnings);
+		warnings.sort(earlier);
+	}
+}
+
+size_t MsgFactory::errorCount() const
+{
+	return errors.size();
+}
+
+size_t MsgFactory::warningCount() const
+{
+	return warnings.size();
+}
+
+void MsgFactory::truncate(size_t nErrors, size_t nWarnings)
+{
+	while (errors.size() > nErrors)
+		errors.pop_back();
+	while (warnings.size() > nWarnings)
+		warnings.pop_back();
+}
+
 void MsgFactory::showMsg(Message *msg)
 {
 	char buffer[500];
-	int line = msg->line;
-	int column = msg->column;
+	int line, column;
+
+	if (source == NULL)
+		return;
 
+	getLineColumn(msg->loc, &line, &column);
 	fseek(source, lineOffset[line-1], SEEK_SET);
-	fgets(buffer, 500, source);
+	if (fgets(buffer, 500, source) == NULL)
+		buffer[0] = '\0';
 
-	fprintf(stdout,"\033[0m" "%s: %d:%d: " "\033[0m", fileName.c_str(), msg->line, msg->column);
+	fprintf(stdout,"\033[0m" "%s: %d:%d: " "\033[0m", fileName.c_str(), line, column);
 	msg->show();
 
 
@@ -158,7 +240,7 @@ int main()
 {
 	MsgFactory msgFactory;
 	msgFactory.initial("test/test1.c");
-	Error e1 = msgFactory.newError(e_miss_op, 2, 10);
+	Error e1 = msgFactory.newError(e_miss_op, 20);
 	msgFactory.showMsg(&e1);
 	return 0;
 }
@@ -3,38 +3,108 @@
 #include <string>
 #include <list>
 #include "node.h"
-#include "visitor.h"
+
+
+// pools owning the heap parts of ValueTypeS (see node.h)
+static list<ValueTypeS *> typePool;
+static list<string *> namePool;
+
+ValueTypeS *newValueType()
+{
+	ValueTypeS *vType = new ValueTypeS;
+	typePool.push_back(vType);
+	return vType;
+}
+
+string *adoptTypeName(string *name)
+{
+	namePool.push_back(name);
+	return name;
+}
+
+void clearTypePool()
+{
+	while (!typePool.empty()) {
+		delete typePool.front();
+		typePool.pop_front();
+	}
+	while (!namePool.empty()) {
+		delete namePool.front();
+		namePool.pop_front();
+	}
+}
+
+
+ConstVal castConstVal(ConstVal val, ValueType from, ValueType to)
+{
+	ConstVal ret;
+
+	if (from == to)
+		return val;
+
+	switch (to) {
+	case INT_TYPE:
+		ret.ival = from == FLOAT_TYPE ? (int)(float)val.fval : (int)val.cval;
+		break;
+	case FLOAT_TYPE:
+		ret.fval = (float)(from == INT_TYPE ? val.ival : val.cval);
+		break;
+	case CHAR_TYPE:
+		ret.cval = from == FLOAT_TYPE ? (char)(int)(float)val.fval : (char)val.ival;
+		break;
+	default:
+		ret = val;
+		break;
+	}
+	return ret;
+}
+
+
+static unsigned int nextNodeId = 0;
+
+unsigned int nodeIdBound()
+{
+	return nextNodeId;
+}
+
+void resetNodeIds()
+{
+	nextNodeId = 0;
+}
 
 
 // implementation of class Node
 Node::Node()
 {
-	loc = new Loc;
+	static const ValueTypeS noType = {NO_TYPE, NO_TYPE, false, false, false,
+			0, NULL, NULL, NULL, NULL, false, {0}};
+
+	valueTy = noType;
+	loc = 0;
+	id = nextNodeId++;
 }
 
 Node::~Node()
 {
-	delete loc;
 }
 
 
-void Node::setLoc(Loc *loc)
+void Node::setLoc(SrcLoc loc)
 {
-	this->loc->first_line 	= loc->first_line;
-	this->loc->first_column = loc->first_column;
-	this->loc->last_line 	= loc->last_line;
-	this->loc->last_column 	= loc->last_column;
+	this->loc = loc;
 }
 
 
 // implementation of class NodeList
 NodeList::NodeList(Node *node)
 {
+	type = NODE_LIST_AST;
 	nodes.push_back(node);
 }
 
 NodeList::NodeList()
 {
+	type = NODE_LIST_AST;
 }
 
 NodeList::~NodeList()
@@ -46,16 +116,6 @@ void NodeList::append(Node *node)
 	nodes.push_back(node);
 }
 
-void NodeList::accept(Visitor &v)
-{
-	for (std::list<Node *>::iterator it = nodes.begin();
-			it != nodes.end(); it++) {
-		(*it)->accept(v);
-	}
-	v.visitNodeList(this);
-}
-
-
 
 // implementation of class NumNode
 NumNode::NumNode(int val)
@@ -68,11 +128,6 @@ NumNode::~NumNode()
 {
 }
 
-void NumNode::accept(Visitor &v)
-{
-	v.visitNumNode(this);
-}
-
 
 // implementation of class FNumNode
 FNumNode::FNumNode(double fval)
@@ -85,11 +140,6 @@ FNumNode::~FNumNode()
 {
 }
 
-void FNumNode::accept(Visitor &v)
-{
-	v.visitFNumNode(this);
-}
-
 
 // implementation of class CharNode
 CharNode::CharNode(char cval)
@@ -102,11 +152,6 @@ CharNode::~CharNode()
 {
 }
 
-void CharNode::accept(Visitor &v)
-{
-	v.visitCharNode(this);
-}
-
 
 // implementation of class BinaryExpNode
 BinaryExpNode::BinaryExpNode(char op, ExpNode *lhs, ExpNode *rhs)
@@ -119,13 +164,6 @@ BinaryExpNode::~BinaryExpNode()
 {
 }
 
-void BinaryExpNode::accept(Visitor &v)
-{
-	lhs->accept(v);
-	rhs->accept(v);
-	v.visitBinaryExpNode(this);
-}
-
 
 // implementation of class BinaryExpNode
 UnaryExpNode::UnaryExpNode(char op, ExpNode *operand)
@@ -138,17 +176,6 @@ UnaryExpNode::~UnaryExpNode()
 {
 }
 
-void UnaryExpNode::accept(Visitor &v)
-{
-	// In some cases (such as code generation), the visiting order should be changed
-	if (v.orderChanged) {
-		v.visitUnaryExpNode(this);
-		return;
-	}
-	operand->accept(v);
-	v.visitUnaryExpNode(this);
-}
-
 
 // implementation of class IdNode
 IdNode::IdNode(std::string *name)
@@ -162,11 +189,6 @@ IdNode::~IdNode()
 	delete name;
 }
 
-void IdNode::accept(Visitor &v)
-{
-	v.visitIdNode(this);
-}
-
 
 // implementation of class ArrayItemNode
 ArrayItemNode::ArrayItemNode(ExpNode *array, NodeList *index)
@@ -179,13 +201,6 @@ ArrayItemNode::~ArrayItemNode()
 {
 }
 
-void ArrayItemNode::accept(Visitor &v)
-{
-	array->accept(v);
-	index->accept(v);
-	v.visitArrayItemNode(this);
-}
-
 
 // implementation of class StructItemNode
 StructItemNode::StructItemNode(ExpNode *stru, string *itemName, bool isPointer)
@@ -196,11 +211,7 @@ StructItemNode::StructItemNode(ExpNode *stru, string *itemName, bool isPointer)
 
 StructItemNode::~StructItemNode()
 {
-}
-
-void StructItemNode::accept(Visitor &v){
-	stru->accept(v);
-	v.visitStructItemNode(this);
+	delete itemName;
 }
 
 
@@ -216,15 +227,6 @@ FunCallNode::~FunCallNode()
 {
 }
 
-void FunCallNode::accept(Visitor &v)
-{
-	func->accept(v);
-	if (hasArgs) {
-		argv->accept(v);
-	}
-	v.visitFunCallNode(this);
-}
-
 
 // implementation of class IdVarDefNode
 IdVarDefNode::IdVarDefNode(std::string *name, ExpNode *value=NULL)
@@ -241,14 +243,6 @@ IdVarDefNode::~IdVarDefNode()
 	delete name;
 }
 
-void IdVarDefNode::accept(Visitor &v)
-{
-	if (isAssigned) {
-		value->accept(v);
-	}
-	v.visitIdVarDefNode(this);
-}
-
 
 // implementation of class ArrayVarDefNode
 ArrayVarDefNode::ArrayVarDefNode(std::string *name, NodeList *values=NULL)
@@ -265,15 +259,6 @@ ArrayVarDefNode::~ArrayVarDefNode()
 	delete name;
 }
 
-void ArrayVarDefNode::accept(Visitor &v)
-{
-	if (isAssigned) {
-		values->accept(v);
-	}
-
-	v.visitArrayVarDefNode(this);
-}
-
 
 // implementation of class BlockNode
 BlockNode::BlockNode(NodeList *blockItems)
@@ -286,17 +271,10 @@ BlockNode::~BlockNode()
 {
 }
 
-void BlockNode::accept(Visitor &v)
-{
-	v.enterBlockNode(this);
-	blockItems->accept(v);
-	v.visitBlockNode(this);
-}
-
 
 // implementation of class AssignStmtNode
-AssignStmtNode::AssignStmtNode(ExpNode *lval, ExpNode *exp)
-	: lval(lval), exp(exp)
+AssignStmtNode::AssignStmtNode(ExpNode *lval, ExpNode *exp, char op)
+	: lval(lval), exp(exp), op(op)
 {
 	type = ASSIGN_STMT_AST;
 }
@@ -305,19 +283,6 @@ AssignStmtNode::~AssignStmtNode()
 {
 }
 
-void AssignStmtNode::accept(Visitor &v)
-{
-	// In some cases (such as code generation), the visiting order should be changed
-	if (v.orderChanged) {
-		v.visitAssignStmtNode(this);
-		return;
-	}
-
-	lval->accept(v);
-	exp->accept(v);
-	v.visitAssignStmtNode(this);
-}
-
 
 // implementation of class FunCallStmtNode
 FunCallStmtNode::FunCallStmtNode(FunCallNode *funCall)
@@ -330,12 +295,6 @@ FunCallStmtNode::~FunCallStmtNode()
 {
 }
 
-void FunCallStmtNode::accept(Visitor &v)
-{
-	funCall->accept(v);
-	v.visitFunCallStmtNode(this);
-}
-
 
 // implementation of class BlockStmtNode
 BlockStmtNode::BlockStmtNode(BlockNode *block)
@@ -348,12 +307,6 @@ BlockStmtNode::~BlockStmtNode()
 {
 }
 
-void BlockStmtNode::accept(Visitor &v)
-{
-	block->accept(v);
-	v.visitBlockStmtNode(this);
-}
-
 
 // implementation of class CondNode
 CondNode::CondNode(OpType op, Node *lhs, Node *rhs)
@@ -366,35 +319,17 @@ CondNode::~CondNode()
 {
 }
 
-void CondNode::accept(Visitor &v)
-{
-	// In some cases (such as code generation), the visiting order should be changed
-	if (v.orderChanged) {
-		v.visitCondNode(this);
-		return;
-	}
-
-	if (this->op != NOT_OP)
-		lhs->accept(v);
-	rhs->accept(v);
-	v.visitCondNode(this);
-}
-
 
 // implementation of class EmptyNode
 EmptyNode::EmptyNode()
 {
+	type = EMPTY_STMT_AST;
 }
 
 EmptyNode::~EmptyNode()
 {
 }
 
-void EmptyNode::accept(Visitor &v)
-{
-	v.visitEmptyNode(this);
-}
-
 
 // implementation of class IfStmtNode
 IfStmtNode::IfStmtNode(CondNode *cond, StmtNode *then_stmt, StmtNode *else_stmt)
@@ -408,26 +343,6 @@ IfStmtNode::~IfStmtNode()
 {
 }
 
-void IfStmtNode::accept(Visitor &v)
-{
-	// In some cases (such as code generation), the visiting order should be changed
-	if (v.orderChanged) {
-		v.visitIfStmtNode(this);
-		return;
-	}
-
-	v.enterIfStmtNode(this);
-
-	cond->accept(v);
-	then_stmt->accept(v);
-
-	if (hasElse) {
-		else_stmt->accept(v);
-	}
-
-	v.visitIfStmtNode(this);
-}
-
 
 // implementation of class WhileStmtNode
 WhileStmtNode::WhileStmtNode(CondNode *cond, StmtNode *do_stmt)
@@ -440,20 +355,19 @@ WhileStmtNode::~WhileStmtNode()
 {
 }
 
-void WhileStmtNode::accept(Visitor &v)
-{
-	// In some cases (such as code generation), the visiting order should be changed
-	if (v.orderChanged) {
-		v.visitWhileStmtNdoe(this);
-		return;
-	}
 
-	v.enterWhileStmtNode(this);
-
-	cond->accept(v);
-	do_stmt->accept(v);
+// implementation of class ForStmtNode
+ForStmtNode::ForStmtNode(StmtNode *init, CondNode *cond, StmtNode *step, StmtNode *do_stmt)
+	: init(init), cond(cond), step(step), do_stmt(do_stmt)
+{
+	type = FOR_STMT_AST;
+	hasInit = (init != NULL);
+	hasCond = (cond != NULL);
+	hasStep = (step != NULL);
+}
 
-	v.visitWhileStmtNdoe(this);
+ForStmtNode::~ForStmtNode()
+{
 }
 
 
@@ -461,47 +375,35 @@ ReturnStmtNode::ReturnStmtNode(ExpNode *exp)
 	: exp(exp)
 {
 	type = RETURN_STMT_AST;
+	hasExp = (exp != NULL);
 }
 
 ReturnStmtNode::~ReturnStmtNode()
 {
 }
 
-void ReturnStmtNode::accept(Visitor &v)
-{
-	exp->accept(v);
-	v.visitReturnStmtNdoe(this);
-}
-
 
 // implementation of class BreakStmtNode
 BreakStmtNode::BreakStmtNode()
 {
-}
-BreakStmtNode::~BreakStmtNode()
-{
+	type = BREAK_STMT_AST;
 }
 
-void BreakStmtNode::accept(Visitor &v)
+BreakStmtNode::~BreakStmtNode()
 {
-	v.visitBreakStmtNode(this);
 }
 
 
 // implementation of class ContinueStmtNode
 ContinueStmtNode::ContinueStmtNode()
 {
+	type = CONTINUE_STMT_AST;
 }
 
 ContinueStmtNode::~ContinueStmtNode()
 {
 }
 
-void ContinueStmtNode::accept(Visitor &v)
-{
-	v.visitContinueStmtNode(this);
-}
-
 
 // implemantatian of class FuncDeclNode
 FuncDeclNode::FuncDeclNode(string *name, bool hasArgs)
@@ -515,17 +417,6 @@ FuncDeclNode::~FuncDeclNode()
 	delete name;
 }
 
-void FuncDeclNode::accept(Visitor &v)
-{
-	// In some cases (such as code generation), the visiting order should be changed
-	if (v.orderChanged) {
-		v.visitFuncDeclNode(this);
-		return;
-	}
-
-	v.visitFuncDeclNode(this);
-}
-
 
 // implementation of class FuncDefNode
 FuncDefNode::FuncDefNode(FuncDeclNode *decl, BlockNode *block)
@@ -538,22 +429,6 @@ FuncDefNode::~FuncDefNode()
 {
 }
 
-void FuncDefNode::accept(Visitor &v)
-{
-	// In some cases (such as code generation), the visiting order should be changed
-	if (v.orderChanged) {
-		v.visitFuncDefNode(this);
-		return;
-	}
-
-	v.enterFuncDefNode(this);
-
-	decl->accept(v);
-	block->accept(v);
-
-	v.visitFuncDefNode(this);
-}
-
 
 // implementation of class VarDeclNode
 VarDeclNode::VarDeclNode(NodeList *defList)
@@ -566,13 +441,6 @@ VarDeclNode::~VarDeclNode()
 {
 }
 
-void VarDeclNode::accept(Visitor &v)
-{
-	defList->accept(v);
-
-	v.visitVarDeclNode(this);
-}
-
 
 // implementation of class StructDefNode
 StructDefNode::StructDefNode(string *name, NodeList *decls)
@@ -583,25 +451,14 @@ StructDefNode::StructDefNode(string *name, NodeList *decls)
 
 StructDefNode::~StructDefNode()
 {
-}
-
-void StructDefNode::accept(Visitor &v)
-{
-	// In some cases (such as code generation), the visiting order should be changed
-	if (v.orderChanged) {
-		v.visitStructDefNode(this);
-		return;
-	}
-
-	v.enterStructDefNode(this);
-	decls->accept(v);
-	v.visitStructDefNode(this);
+	delete name;
 }
 
 
 // implementation of class CompUnitNode
 CompUnitNode::CompUnitNode(Node *node)
 {
+	type = COMP_UNIT_AST;
 	nodes.push_back(node);
 }
 
@@ -614,17 +471,6 @@ void CompUnitNode::append(Node *node)
 	nodes.push_back(node);
 }
 
-void CompUnitNode::accept(Visitor &v)
-{
-	for (std::list<Node *>::iterator it = nodes.begin();
-			it != nodes.end(); it++) {
-		(*it)->accept(v);
-	}
-
-	v.visitCompUnitNode(this);
-}
-
-
 
 /*
 int main()
@@ -0,0 +1,267 @@
+#include <list>
+
+#include "simplify_visitor.h"
+#include "node.h"
+
+
+using namespace std;
+
+
+SimplifyVisitor::SimplifyVisitor(TypeTable &types, MsgFactory &msgs)
+	: types(types), msgs(msgs)
+{
+	breaks = false;
+}
+
+
+SimplifyVisitor::~SimplifyVisitor()
+{
+	// empty
+}
+
+
+int SimplifyVisitor::folded(CondNode *cond) const
+{
+	const ValueTypeS &vType = types[cond];
+	if (!vType.isComputed)
+		return -1;
+	return vType.constVal.ival != 0 ? 1 : 0;
+}
+
+
+bool SimplifyVisitor::visitNodeList(NodeList *node)
+{
+	return true;
+}
+
+
+bool SimplifyVisitor::visitNumNode(NumNode *node)
+{
+	return true;
+}
+
+
+bool SimplifyVisitor::visitFNumNode(FNumNode *node)
+{
+	return true;
+}
+
+
+bool SimplifyVisitor::visitCharNode(CharNode *node)
+{
+	return true;
+}
+
+
+bool SimplifyVisitor::visitBinaryExpNode(BinaryExpNode *node)
+{
+	return true;
+}
+
+
+bool SimplifyVisitor::visitUnaryExpNode(UnaryExpNode *node)
+{
+	return true;
+}
+
+
+bool SimplifyVisitor::visitIdNode(IdNode *node)
+{
+	return true;
+}
+
+
+bool SimplifyVisitor::visitArrayItemNode(ArrayItemNode *node)
+{
+	return true;
+}
+
+
+bool SimplifyVisitor::visitStructItemNode(StructItemNode *node)
+{
+	return true;
+}
+
+
+bool SimplifyVisitor::visitFunCallNode(FunCallNode *node)
+{
+	return true;
+}
+
+
+bool SimplifyVisitor::visitIdVarDefNode(IdVarDefNode *node)
+{
+	return true;
+}
+
+
+bool SimplifyVisitor::visitArrayVarDefNode(ArrayVarDefNode *node)
+{
+	return true;
+}
+
+
+bool SimplifyVisitor::visitEmptyNode(EmptyNode *node)
+{
+	return true;
+}
+
+
+bool SimplifyVisitor::visitBlockNode(BlockNode *node)
+{
+	bool reachable = true;
+	bool warned = false;
+
+	list<Node *> &items = node->blockItems->nodes;
+	for (list<Node *>::iterator it = items.begin(); it != items.end(); it++) {
+		if (reachable) {
+			reachable = visit(*it);
+			continue;
+		}
+
+		types.prune(*it);
+		if (!warned && (*it)->type != EMPTY_STMT_AST) {
+			msgs.newWarning(w_unreachable_code, (*it)->loc);
+			warned = true;
+		}
+	}
+	return reachable;
+}
+
+
+bool SimplifyVisitor::visitVarDeclNode(VarDeclNode *node)
+{
+	return true;
+}
+
+
+bool SimplifyVisitor::visitAssignStmtNode(AssignStmtNode *node)
+{
+	return true;
+}
+
+
+bool SimplifyVisitor::visitFunCallStmtNode(FunCallStmtNode *node)
+{
+	return true;
+}
+
+
+bool SimplifyVisitor::visitBlockStmtNode(BlockStmtNode *node)
+{
+	return visit(node->block);
+}
+
+
+bool SimplifyVisitor::visitCondNode(CondNode *node)
+{
+	return true;
+}
+
+
+bool SimplifyVisitor::visitIfStmtNode(IfStmtNode *node)
+{
+	switch (folded(node->cond)) {
+	case 1:
+		if (node->hasElse)
+			types.prune(node->else_stmt);
+		return visit(node->then_stmt);
+	case 0:
+		types.prune(node->then_stmt);
+		return node->hasElse ? visit(node->else_stmt) : true;
+	default:
+	{
+		bool thenFalls = visit(node->then_stmt);
+		bool elseFalls = node->hasElse ? visit(node->else_stmt) : true;
+		return thenFalls || elseFalls;
+	}
+	}
+}
+
+
+bool SimplifyVisitor::visitWhileStmtNdoe(WhileStmtNode *node)
+{
+	int cond = folded(node->cond);
+	if (cond == 0) {
+		types.prune(node->do_stmt);
+		return true;
+	}
+
+	bool outer = breaks;
+	breaks = false;
+	visit(node->do_stmt);
+	bool exits = breaks;
+	breaks = outer;
+
+	// a loop that never ends is left by break only
+	return cond != 1 || exits;
+}
+
+
+// the step is part of the loop, it is left out along with the body
+bool SimplifyVisitor::visitForStmtNode(ForStmtNode *node)
+{
+	int cond = node->hasCond ? folded(node->cond) : 1;
+	if (cond == 0) {
+		types.prune(node->do_stmt);
+		return true;
+	}
+
+	bool outer = breaks;
+	breaks = false;
+	visit(node->do_stmt);
+	bool exits = breaks;
+	breaks = outer;
+
+	return cond != 1 || exits;
+}
+
+
+bool SimplifyVisitor::visitReturnStmtNdoe(ReturnStmtNode *node)
+{
+	return false;
+}
+
+
+bool SimplifyVisitor::visitBreakStmtNode(BreakStmtNode *node)
+{
+	breaks = true;
+	return false;
+}
+
+
+bool SimplifyVisitor::visitContinueStmtNode(ContinueStmtNode *node)
+{
+	return false;
+}
+
+
+bool SimplifyVisitor::visitFuncDeclNode(FuncDeclNode *node)
+{
+	return true;
+}
+
+
+bool SimplifyVisitor::visitFuncDefNode(FuncDefNode *node)
+{
+	breaks = false;
+	visit(node->block);
+	return true;
+}
+
+
+bool SimplifyVisitor::visitStructDefNode(StructDefNode *node)
+{
+	return true;
+}
+
+
+bool SimplifyVisitor::visitCompUnitNode(CompUnitNode *node)
+{
+	for (list<Node *>::iterator it = node->nodes.begin();
+			it != node->nodes.end(); it++) {
+		if ((*it)->type == FUNC_DEF_AST)
+			visit(*it);
+	}
+	return true;
+}
@@ -0,0 +1,156 @@
+#include "symbol_table.h"
+
+using namespace std;
+
+
+SymbolTable::SymbolTable()
+	: slots(64), usedSlots(0)
+{
+	for (vector<Slot>::iterator it = slots.begin(); it != slots.end(); it++)
+		it->used = false;
+}
+
+
+void SymbolTable::enterScope()
+{
+	scopeStart.push_back(bindings.size());
+}
+
+
+void SymbolTable::exitScope()
+{
+	int start = scopeStart.back();
+	scopeStart.pop_back();
+	rewind(start);
+}
+
+
+int SymbolTable::depth() const
+{
+	return scopeStart.size();
+}
+
+
+bool SymbolTable::declare(const string &name, const ValueTypeS &vType, const Node *decl)
+{
+	unsigned int hash = hashName(name);
+	int s = findSlot(name, hash);
+
+	if (!slots[s].used) {
+		// keep the load factor under one half
+		if (2 * (usedSlots + 1) > slots.size()) {
+			grow();
+			s = findSlot(name, hash);
+		}
+		slots[s].name = name;
+		slots[s].hash = hash;
+		slots[s].binding = -1;
+		slots[s].used = true;
+		usedSlots++;
+	}
+
+	int shadowed = slots[s].binding;
+	if (shadowed != -1 && bindings[shadowed].scope == depth())
+		return false;
+
+	Binding b;
+	b.slot = s;
+	b.shadowed = shadowed;
+	b.scope = depth();
+	b.vType = vType;
+	b.decl = decl;
+	bindings.push_back(b);
+	slots[s].binding = bindings.size() - 1;
+	return true;
+}
+
+
+const ValueTypeS *SymbolTable::lookUp(const string &name, const Node **decl) const
+{
+	int s = findSlot(name, hashName(name));
+	if (!slots[s].used || slots[s].binding == -1)
+		return NULL;
+	const Binding &b = bindings[slots[s].binding];
+	*decl = b.decl;
+	return &b.vType;
+}
+
+
+bool SymbolTable::isGlobal(const string &name) const
+{
+	int s = findSlot(name, hashName(name));
+	if (!slots[s].used || slots[s].binding == -1)
+		return false;
+	return bindings[slots[s].binding].scope == 0;
+}
+
+
+int SymbolTable::height() const
+{
+	return bindings.size();
+}
+
+
+// undo the bindings above height, newest first
+void SymbolTable::rewind(int height)
+{
+	while ((int)bindings.size() > height) {
+		Binding &b = bindings.back();
+		slots[b.slot].binding = b.shadowed;
+		bindings.pop_back();
+	}
+}
+
+
+void SymbolTable::replay(const SymbolTable &from, int height)
+{
+	for (int i = bindings.size(); i < height; i++) {
+		const Binding &b = from.bindings[i];
+		declare(from.slots[b.slot].name, b.vType, b.decl);
+	}
+}
+
+
+// FNV-1a
+unsigned int SymbolTable::hashName(const string &name)
+{
+	unsigned int hash = 2166136261u;
+	for (string::const_iterator it = name.begin(); it != name.end(); it++) {
+		hash ^= (unsigned char)*it;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+
+// the slot holding name, or the empty slot where it would go
+int SymbolTable::findSlot(const string &name, unsigned int hash) const
+{
+	unsigned int mask = slots.size() - 1;
+	unsigned int i = hash & mask;
+	while (slots[i].used && (slots[i].hash != hash || slots[i].name != name))
+		i = (i + 1) & mask;
+	return i;
+}
+
+
+// double the slots, names never leave the table so there are no tombstones
+void SymbolTable::grow()
+{
+	vector<Slot> old(slots.size() * 2);
+	old.swap(slots);
+	for (vector<Slot>::iterator it = slots.begin(); it != slots.end(); it++)
+		it->used = false;
+
+	vector<int> moved(old.size());
+	for (unsigned int i = 0; i < old.size(); i++) {
+		if (!old[i].used)
+			continue;
+		int s = findSlot(old[i].name, old[i].hash);
+		slots[s] = old[i];
+		moved[i] = s;
+	}
+
+	for (vector<Binding>::iterator it = bindings.begin(); it != bindings.end(); it++)
+		it->slot = moved[it->slot];
+}
@@ -0,0 +1,102 @@
+#include "type_table.h"
+
+using namespace std;
+
+
+TypeTable::TypeTable(unsigned int size)
+	: types(size), present(size, 0), decls(size, (const Node *)NULL),
+	  fields(size, -1), dead(size, 0)
+{
+	pthread_mutex_init(&ownedLock, NULL);
+}
+
+
+TypeTable::~TypeTable()
+{
+	for (list<ValueTypeS *>::iterator it = ownedTypes.begin();
+			it != ownedTypes.end(); it++)
+		delete *it;
+	for (list<int *>::iterator it = ownedBases.begin();
+			it != ownedBases.end(); it++)
+		delete[] *it;
+	pthread_mutex_destroy(&ownedLock);
+}
+
+
+const ValueTypeS &TypeTable::operator[](const Node *node) const
+{
+	if (node->id < present.size() && present[node->id])
+		return types[node->id];
+	return node->valueTy;
+}
+
+
+// the slot of node, starting from its declared type on first use
+ValueTypeS &TypeTable::annotate(const Node *node)
+{
+	if (!present[node->id]) {
+		types[node->id] = node->valueTy;
+		present[node->id] = 1;
+	}
+	return types[node->id];
+}
+
+
+void TypeTable::bind(const IdNode *use, const Node *decl)
+{
+	decls[use->id] = decl;
+}
+
+
+const Node *TypeTable::declOf(const IdNode *use) const
+{
+	if (use->id < decls.size())
+		return decls[use->id];
+	return NULL;
+}
+
+
+void TypeTable::setField(const StructItemNode *item, int index)
+{
+	fields[item->id] = index;
+}
+
+
+int TypeTable::fieldOf(const StructItemNode *item) const
+{
+	if (item->id < fields.size())
+		return fields[item->id];
+	return -1;
+}
+
+
+void TypeTable::prune(const Node *stmt)
+{
+	dead[stmt->id] = 1;
+}
+
+
+bool TypeTable::pruned(const Node *stmt) const
+{
+	return stmt->id < dead.size() && dead[stmt->id];
+}
+
+
+ValueTypeS *TypeTable::newType(const ValueTypeS &vType)
+{
+	ValueTypeS *t = new ValueTypeS(vType);
+	pthread_mutex_lock(&ownedLock);
+	ownedTypes.push_back(t);
+	pthread_mutex_unlock(&ownedLock);
+	return t;
+}
+
+
+int *TypeTable::newBase(int dim)
+{
+	int *base = new int[dim];
+	pthread_mutex_lock(&ownedLock);
+	ownedBases.push_back(base);
+	pthread_mutex_unlock(&ownedLock);
+	return base;
+}
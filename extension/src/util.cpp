@@ -1,34 +1,46 @@
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <getopt.h>
 #include "util.h"
 #include "global.h"
 
 extern bool typeDebugFlag;
+extern bool fusedFlag;
+extern bool incrementalFlag;
+extern int repeatCount;
 
 // use getopt_long to handle arguments
 // -h       show help
 // -v       show version
 // -o file  place results to file
 // -d file  dump AST to file
+// -f       check and generate code item by item
+// -i       only check and generate the functions changed since last time
+// -r n     compile n times in one process, checking that memory stays flat
 bool handle_opt(int argc, char** argv)
 {
     int c;
     int version_flag = 0;
     int help_flag = 0;
     int type_debug_flag = 0;
+    int fused_flag = 0;
+    int incremental_flag = 0;
     struct option long_options[] =
     {
         {"version", no_argument, &version_flag, 'v'},
         {"help", no_argument, &help_flag, 'h'},
         {"dump", required_argument, NULL, 'd'},
 		{"type", no_argument, &type_debug_flag, 't'},
+		{"fused", no_argument, &fused_flag, 'f'},
+		{"incremental", no_argument, &incremental_flag, 'i'},
+		{"repeat", required_argument, NULL, 'r'},
         {0, 0, 0, 0}
     };
     int option_index = 0;
     opterr = 0;
 
-    while ((c = getopt_long(argc, argv, ":hvto:d:", long_options, &option_index)) != -1) {
+    while ((c = getopt_long(argc, argv, ":hvtfio:d:r:", long_options, &option_index)) != -1) {
         switch (c)
         {
             case 0:
@@ -45,6 +57,15 @@ bool handle_opt(int argc, char** argv)
             case 't':
             	type_debug_flag = 1;
             	break;
+            case 'f':
+            	fused_flag = 1;
+            	break;
+            case 'i':
+            	incremental_flag = 1;
+            	break;
+            case 'r':
+            	repeatCount = atoi(optarg);
+            	break;
             case '?':
                 printf("Unknown option -%c\n", optopt);
                 return false;
@@ -53,6 +74,8 @@ bool handle_opt(int argc, char** argv)
                     printf("Option -o requires an argument. Not support yet\n");
                 else if (optopt == 'd')
                     printf("Option -d requires an argument. Not support yet\n");
+                else if (optopt == 'r')
+                    printf("Option -r requires an argument\n");
                 else
                     printf("Unknown option -%c\n", optopt);
                 return false;
@@ -67,6 +90,15 @@ bool handle_opt(int argc, char** argv)
         printf("-h  --help     print this usage and exit\n");
         printf("-v  --version  print version and exit\n");
         printf("-d <file>      dump AST into <file>\n");
+        printf("-f  --fused    type check and generate code in one pass\n");
+        printf("               (ignored with -t or -d); functions get no\n");
+        printf("               attributes from the effect analysis\n");
+        printf("-i  --incremental  only check and generate the functions changed\n");
+        printf("               since the last compilation of the file (ignored\n");
+        printf("               with -f, -t or -d)\n");
+        printf("-r <n>         compile the file n times in one process and fail\n");
+        printf("               if memory keeps growing (leak test); files given\n");
+        printf("               after the first are compiled in turn with it\n");
         return false;
     }
     if (version_flag)
@@ -100,5 +132,9 @@ bool handle_opt(int argc, char** argv)
     }
     if (type_debug_flag)
     	typeDebugFlag = true;
+    if (fused_flag)
+    	fusedFlag = true;
+    if (incremental_flag)
+    	incrementalFlag = true;
     return true;
 }
@@ -0,0 +1,112 @@
+extern void print(int c);
+extern void print_char(char c);
+extern void print_float(float f);
+extern void print_space();
+extern void print_newline();
+
+// Structs cross calls as the x86-64 C ABI says: up to 16 bytes in one
+// register per eightbyte, a general one unless it holds only floats; larger
+// ones, or ones there are not enough registers left for, in memory.  The
+// abi_ functions are compiled by the C compiler, see libexternfunc.c.
+
+struct abi_pair {
+	int a;
+	int b;
+};
+
+struct abi_mixed {
+	int id;
+	float score;
+	char tag;
+};
+
+struct abi_floats {
+	float x;
+	float y;
+	float z;
+};
+
+struct abi_big {
+	int v[5];
+};
+
+extern struct abi_pair abi_swap(struct abi_pair p);
+extern struct abi_mixed abi_next(struct abi_mixed m);
+extern struct abi_floats abi_scale(struct abi_floats f, float k);
+extern struct abi_big abi_reverse(struct abi_big b);
+extern int abi_last(int a, int b, int c, int d, int e, int f, struct abi_pair p);
+extern void abi_callback(struct abi_mixed (*f)(struct abi_mixed m, struct abi_floats g));
+
+// called back from C
+struct abi_mixed combine(struct abi_mixed m, struct abi_floats g)
+{
+	m.id = m.id * 10;
+	m.score = m.score + g.x + g.y + g.z;
+	m.tag = m.tag - 1;
+	return m;
+}
+
+// the same, between two functions of the program
+struct abi_floats mirror(struct abi_floats f)
+{
+	struct abi_floats r;
+	r.x = f.z;
+	r.y = f.y;
+	r.z = f.x;
+	return r;
+}
+
+// writes nothing but its result, which is the caller's memory, so the call
+// must not be taken for one without effects
+struct abi_big fill(int k)
+{
+	struct abi_big b;
+	int i = 0;
+	while (i < 5) {
+		b.v[i] = k + i;
+		i = i + 1;
+	}
+	return b;
+}
+
+int main()
+{
+	struct abi_pair p;
+	p.a = 1; p.b = 2;
+	p = abi_swap(p);
+	print(p.a); print_space(); print(p.b);		// 2 1
+	print_newline();
+
+	struct abi_mixed m;
+	m.id = 41; m.score = 1.25; m.tag = 'a';
+	m = abi_next(m);
+	print(m.id); print_space(); print_float(m.score); print_space(); print_char(m.tag);	// 42 2.50 b
+	print_newline();
+
+	struct abi_floats f;
+	f.x = 1; f.y = 2; f.z = 3;
+	f = mirror(abi_scale(f, 0.5));
+	print_float(f.x); print_space(); print_float(f.y); print_space(); print_float(f.z);	// 1.50 1.00 0.50
+	print_newline();
+
+	struct abi_big b;
+	int i = 0;
+	while (i < 5) {
+		b.v[i] = i * i;
+		i = i + 1;
+	}
+	b = abi_reverse(b);
+	print(b.v[0]); print_space(); print(b.v[4]);		// 16 0
+	print_newline();
+
+	b = fill(10);
+	print(b.v[2]);		// 12
+	print_newline();
+
+	print(abi_last(1, 2, 3, 4, 5, 6, p));		// 1221
+	print_newline();
+
+	abi_callback(combine);		// 70 3.00 o
+	print_newline();
+	return 0;
+}
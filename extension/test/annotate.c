@@ -0,0 +1,59 @@
+extern void print(int c);
+extern void print_char(char c);
+extern void print_float(float f);
+extern void print_space();
+extern void print_newline();
+
+// What the checker works out (types, implicit casts, folded constants,
+// resolved array bounds) goes into a table beside the tree, the tree is
+// not changed.  Declarations that share a declared type, and expressions
+// used more than once, must keep their own results.
+
+const int ROWS = 1 + 1;
+const int COLS = ROWS * 2 - 1;
+
+int grid[ROWS][COLS], other[ROWS][COLS];
+
+float average(int a, int b)
+{
+	return (a + b) / 2.0;
+}
+
+int main()
+{
+	// the bounds of both arrays come from the same declared type
+	int i = 0;
+	while (i < ROWS) {
+		int j = 0;
+		while (j < COLS) {
+			grid[i][j] = i * COLS + j;
+			other[i][j] = grid[i][j] * 10;
+			j = j + 1;
+		}
+		i = i + 1;
+	}
+	print(grid[1][2]); print_space(); print(other[1][0]); print_space();
+	print(grid[0][2] + other[0][1]);	// 5 30 12
+	print_newline();
+
+	// the same operands cast differently by the context they are used in
+	char c = 'a';
+	int n = c + 1;
+	float f = c + 1;
+	char d = n + 1;
+	print(n); print_space(); print_float(f); print_space(); print_char(d);	// 98 98.00 c
+	print_newline();
+
+	// a folded constant next to the same expression on variables
+	float x = ROWS / 4.0;
+	float y = n / 4.0;
+	print_float(x); print_space(); print_float(y); print_space();
+	print_float(average(ROWS, COLS));		// 0.50 24.50 2.50
+	print_newline();
+
+	// '&' of an item of a two dimensional array
+	int *p = &grid[1][1];
+	*p = 40;
+	print(grid[1][1] + *p); print_space(); print(grid[1][2]);	// 80 5
+	print_newline();
+}
@@ -0,0 +1,66 @@
+extern void print(int c);
+extern void print_char(char c);
+extern void print_float(float f);
+extern void print_space();
+extern void print_newline();
+
+// A local array with 16 or more constant items is copied in from a constant
+// table with one memcpy, a zero tail of 16 or more items is cleared with one
+// memset; shorter runs are stored item by item.  Expected in arrayinit.ll:
+// memcpy for counts, memset for the tails of sparse, weights and zeros,
+// plain stores for small.  squares and letters are only read at constant
+// indices, so the function pass manager folds their loads away.
+// sumOf also takes arrays of 20 and 30 items, as C allows.  More items than
+// the array holds are an error, see arrayinit_long.c.
+
+int sumOf(int a[40], int n)
+{
+	int s = 0;
+	int i = 0;
+	while (i < n) {
+		s = s + a[i];
+		i = i + 1;
+	}
+	return s;
+}
+
+int main()
+{
+	int squares[20] = {0, 1, 4, 9, 16, 25, 36, 49, 64, 81,
+			100, 121, 144, 169, 196, 225, 256, 289, 324, 361};
+	print(squares[0]); print_space(); print(squares[19]); print_space();
+	print(squares[7] + squares[12]);		// 0 361 193
+	print_newline();
+
+	int sparse[40] = {7, 8, 9};
+	print(sumOf(sparse, 40)); print_space(); print(sparse[2]); print_space();
+	print(sparse[39]);		// 24 9 0
+	print_newline();
+
+	char letters[] = {'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j',
+			'k', 'l', 'm', 'n', 'o', 'p', 'q'};
+	print_char(letters[0]); print_char(letters[16]); print_space();
+
+	// items that are not constants, and a short array
+	int x = 5;
+	int small[4] = {x, x * 2};
+	float weights[20] = {0.5, 1.5};
+	print(small[1] + small[3]); print_space();
+	print_float(weights[0] + weights[1] + weights[19]);		// aq 10 2.00
+	print_newline();
+
+	// initialized again on every iteration
+	int round = 0;
+	int total = 0;
+	while (round < 3) {
+		int counts[20] = {1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+				1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
+		int zeros[30] = {round};
+		counts[round] = 10;
+		zeros[29] = zeros[29] + 1;
+		total = total + sumOf(counts, 20) + sumOf(zeros, 30);
+		round = round + 1;
+	}
+	print(total);		// 3 * (29 + 1) + 0 + 1 + 2 = 93
+	print_newline();
+}
@@ -0,0 +1,14 @@
+extern void print(int c);
+
+// More initializers than the array holds is an error; a list this long
+// would otherwise be copied whole into the smaller array with memcpy.
+//
+//   test/arrayinit_long.c: 11:6: excess elements in array initializer
+//   compiling completed: totally 1 errors, 0 warnings
+
+int main()
+{
+	int a[16] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
+			11, 12, 13, 14, 15, 16, 17, 18, 19, 20};
+	print(a[15]);
+}
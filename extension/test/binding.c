@@ -0,0 +1,68 @@
+extern void print(int c);
+extern void print_float(float f);
+extern void print_space();
+extern void print_newline();
+
+// The checker binds every name to its declaration once and codegen only
+// follows these bindings, so the same name must reach the right variable,
+// argument or function wherever it is declared.
+
+int value = 7;
+int list[3] = {1, 2, 3};
+
+int inc(int value)
+{
+	return value + 1;		// the argument, not the global
+}
+
+// an argument hides the function of the same name
+int apply(int (*inc)(int v), int v)
+{
+	return inc(v) * 10;
+}
+
+int dec(int v)
+{
+	return v - 1;
+}
+
+int fact(int n)
+{
+	if (n <= 1)
+		return 1;
+	return n * fact(n - 1);
+}
+
+int main()
+{
+	print(inc(value)); print_space(); print(apply(dec, value)); print_space();
+	print(apply(inc, 1));		// 8 60 20
+	print_newline();
+
+	// sibling blocks with the same name at different types
+	{
+		float t = 2.5;
+		print_float(t * 2); print_space();
+	}
+	{
+		int t = 4;
+		print(t * 2); print_space();
+	}
+	// a local array hiding the global one, then the global again
+	{
+		int list[3] = {10, 20, 30};
+		print(list[2]); print_space();
+	}
+	print(list[2]);		// 5.00 8 30 3
+	print_newline();
+
+	// a local hiding the global, and a block hiding the local
+	int value = 1;
+	{
+		int value = 2;
+		value = value + 40;
+		print(value); print_space();
+	}
+	print(value); print_space(); print(fact(5));	// 42 1 120
+	print_newline();
+}
@@ -0,0 +1,62 @@
+extern void print(int c);
+extern void print_char(char c);
+extern void print_space();
+extern void print_newline();
+
+// Conditions are lowered to chains of branches: the right operand of && and
+// || is only evaluated when it decides the result, and ! swaps the targets.
+// Every call of check() below prints its argument, so the output shows
+// which operands ran.
+
+int check(int v)
+{
+	print(v);
+	return v;
+}
+
+int main()
+{
+	// short-circuit
+	if (check(0) > 0 && check(1) > 0)
+		print_char('y');
+	else
+		print_char('n');
+	print_space();
+	if (check(1) > 0 || check(2) > 0)
+		print_char('y');
+	print_space();
+	if (check(0) > 0 || check(3) > 0 && check(4) > 0)
+		print_char('y');
+	print_newline();		// 0n 1y 034y
+
+	// negation and nesting
+	if (!(check(5) > 0 && check(0) > 0))
+		print_char('y');
+	print_space();
+	if (!(check(0) > 0) && !(check(6) < 0 || check(7) < 0))
+		print_char('y');
+	print_space();
+	if ((check(0) > 0 || check(8) > 0) && (check(9) < 0 || check(1) > 0))
+		print_char('y');
+	print_newline();		// 50y 067y 0891y
+
+	// conditions of loops, evaluated again on every iteration
+	int i = 0;
+	int n = 0;
+	while (i < 10 && !(i > 2 && i * i > 8))
+		i = i + 1;
+	for (n = 0; n < 5 || n == 7; n++)
+		if (n == 4)
+			n = 6;
+	print(i); print_space(); print(n);		// 3 8
+	print_newline();
+
+	// floats and chars
+	float f = 0.5;
+	char c = 'k';
+	if (f > 0.25 && f <= 0.5 && c >= 'a' && c != 'z')
+		print_char('y');
+	if (f == 1 || c < 'a')
+		print_char('n');
+	print_newline();		// y
+}
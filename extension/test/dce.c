@@ -0,0 +1,55 @@
+extern void print(int c);
+extern void print_space();
+extern void print_newline();
+
+// This file defines main, so only what main reaches is generated.  The
+// dead functions below call missing(), which the runtime does not define:
+// the program only links if they are left out.  Expected in dce.ll:
+//   defined:  main, live, viaPointer, useTable
+//   globals:  table, used
+//   not there: dead, alsoDead, unused, alsoUnused, DEBUG, missing
+
+extern void missing();
+
+const int DEBUG = 0;
+
+int table[4] = {1, 2, 3, 4};
+int used = 5;
+int unused = 6;
+static int alsoUnused[100];
+
+void alsoDead()
+{
+	missing();
+	unused = 0;
+}
+
+// only called by a dead function
+void dead()
+{
+	alsoDead();
+	alsoUnused[0] = 1;
+}
+
+int live(int x)
+{
+	return x + used;
+}
+
+int viaPointer(int x)
+{
+	return x * 2;
+}
+
+int useTable(int (*f)(int x), int i)
+{
+	return f(table[i]);
+}
+
+int main()
+{
+	print(live(1)); print_space(); print(useTable(viaPointer, 3));	// 6 8
+	print_newline();
+	if (DEBUG > 0)
+		dead();		// folded away, so dead is not reached
+}
@@ -0,0 +1,131 @@
+extern void print(int c);
+extern void print_space();
+extern void print_newline();
+
+// The effect analysis marks functions and pointer arguments for LLVM, and
+// run.sh optimizes this file with opt -O2 before running it, so a wrong
+// attribute shows up as a wrong result.  Expected in effects.ll:
+//   square      readnone
+//   total       readonly, a: nocapture readonly
+//   fill        a: nocapture
+//   readCount   readonly
+//   bump        (writes a global)
+//   keep        (p is stored, so not nocapture)
+//   poke        (writes through a pointer kept in a global)
+//   apply       (calls through a pointer, anything may happen)
+//   makePair    (returns a struct, writes the caller's memory)
+// and every function nounwind.
+
+struct pair {
+	int a;
+	int b;
+};
+
+int count = 0;
+int *kept;
+
+int square(int x)
+{
+	return x * x;
+}
+
+int total(int a[4], int n)
+{
+	int s = 0;
+	int i = 0;
+	while (i < n) {
+		s = s + a[i];
+		i = i + 1;
+	}
+	return s;
+}
+
+void fill(int a[4], int n, int v)
+{
+	int i = 0;
+	while (i < n) {
+		a[i] = v + i;
+		i = i + 1;
+	}
+}
+
+int readCount()
+{
+	return count;
+}
+
+void bump()
+{
+	count = count + 1;
+}
+
+void keep(int *p)
+{
+	kept = p;
+}
+
+void poke(int v)
+{
+	*kept = v;
+}
+
+int apply(int (*f)(), int times)
+{
+	int s = 0;
+	int i = 0;
+	while (i < times) {
+		s = s + f();
+		i = i + 1;
+	}
+	return s;
+}
+
+int bumpAndRead()
+{
+	bump();
+	return readCount();
+}
+
+struct pair makePair(int a, int b)
+{
+	struct pair p;
+	p.a = a;
+	p.b = b;
+	return p;
+}
+
+int main()
+{
+	int v[4];
+	fill(v, 4, 10);
+	int before = total(v, 4);
+	v[0] = square(5);
+	print(before); print_space(); print(total(v, 4));		// 46 61
+	print_newline();
+
+	// count changes between the reads
+	int c0 = readCount();
+	bump();
+	int c1 = readCount();
+	print(c0); print_space(); print(c1); print_space();
+	print(apply(bumpAndRead, 3));		// 0 1 9
+	print_newline();
+
+	// v[1] changes through the kept pointer
+	int x = 1;
+	keep(&x);
+	int y = x;
+	poke(7);
+	print(y); print_space(); print(x); print_space();
+	keep(&v[1]);
+	int old = v[1];
+	poke(99);
+	print(old); print_space(); print(v[1]);		// 1 7 11 99
+	print_newline();
+
+	// a call whose only effect is the result it returns
+	struct pair p = makePair(3, 4);
+	makePair(5, 6);
+	print(p.a * 10 + p.b);		// 34
+	print_newline();
+}
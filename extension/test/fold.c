@@ -0,0 +1,62 @@
+extern void print(int c);
+extern void print_char(char c);
+extern void print_float(float f);
+extern void print_space();
+extern void print_newline();
+
+// all the arithmetic and conditions below are folded by the checker, the
+// generated code only passes constants to the print functions
+
+const int N = 3 * 4 - 2;		// 10
+const float HALF = 1 / 2.0;		// 0.50
+const char NEXT = 'a' + 1;		// 'b'
+const float F = 7;				// int to float
+const int I = 7.9;				// float to int
+
+int table[N / 2 + 'b' - NEXT];	// 5 items
+const int PRIMES[6] = {2, 3, 5, 7, 11};
+
+int main()
+{
+	// int
+	print(N);  print_space(); print(7 / 2); print_space(); print(-7 % 3);		// 10 3 -1
+	print_newline();
+	print(-(2 - 5)); print_space(); print(2147483647 + 1);	// 3 -2147483648
+	print_newline();
+
+	// float
+	print_float(HALF); print_space(); print_float(F / 2); print_space();
+	print_float(-HALF * 3);		// 0.50 3.50 -1.50
+	print_newline();
+	print(I); print_space(); print(HALF * 5);		// 7 2
+	print_newline();
+
+	// char
+	print_char(NEXT); print_char('a' + 2); print_char(NEXT - 'a' + 'A');	// bcB
+	print_newline();
+	print('a' - 'b'); print_space(); print(-'a');		// -1 -97
+	print_newline();
+
+	// conditions
+	if (N > 9 && !(HALF == 0.5 || 1 / 0 > 0))
+		print(0);
+	else
+		print(1);		// 1
+	if ('a' < 98 && 2.5 >= 2 && N != 11)
+		print(1);		// 1
+	while (N < 0)
+		print(0);
+	print_newline();
+
+	// const tables and locals
+	const char digits[] = {'0', '1', '2', '3'};
+	const int K = PRIMES[3] * 2;
+	const int *pk = &K;
+	print(PRIMES[4]); print_space(); print(PRIMES[5]); print_space(); print(K);	// 11 0 14
+	print_space(); print(*pk); print_space(); print_char(digits[K - 12]);		// 14 2
+	print_newline();
+
+	table[4] = N;
+	print(table[4]);	// 10
+	print_newline();
+}
@@ -0,0 +1,50 @@
+extern void print(int c);
+extern void print_char(char c);
+extern void print_space();
+extern void print_newline();
+
+// Compiled with -f: each declaration, struct and function is checked and
+// its code generated before the next one is read, so everything below may
+// only use what comes before it.  The output is the same as without -f.
+
+struct counter {
+	int count;
+	char name;
+};
+
+int total = 5;
+
+void bump(struct counter *c, int by)
+{
+	c->count = c->count + by;
+	total = total + by;
+}
+
+const int STEP = 3;
+
+int twice(int x)
+{
+	return x * 2;
+	print(x);		// warning: unreachable, removed as without -f
+}
+
+struct counter global;
+
+int main()
+{
+	struct counter local;
+	local.count = 1;
+	local.name = 'l';
+	global.count = 10;
+	global.name = 'g';
+	bump(&local, STEP);
+	bump(&global, twice(STEP));
+	print_char(local.name); print(local.count); print_space();
+	print_char(global.name); print(global.count); print_space();
+	print(total);		// l4 g16 14
+	print_newline();
+	if (STEP > 5)
+		print(0);		// folded away
+	print(twice(total));	// 28
+	print_newline();
+}
@@ -0,0 +1,54 @@
+extern void print(int c);
+extern void print_char(char c);
+extern void print_float(float f);
+extern void print_space();
+extern void print_newline();
+
+// A global array without an initializer is a zeroinitializer; one with an
+// initialized prefix and a zero tail of 16 or more items is a struct of the
+// prefix and a zeroinitializer, seen through a bitcast.  Expected in
+// globals.ll:
+//   @counts = global [1000 x i32] zeroinitializer
+//   @primes = global { [5 x i32], [995 x i32] } { ..., zeroinitializer }
+//   @ratios = global { [2 x float], [30 x float] } ...
+//   @short  = global [6 x i32] [i32 1, i32 2, i32 0, ...]
+//   @name   = global { [2 x i8], [18 x i8] } { [2 x i8] c"c1", zeroinitializer }
+//   @grid   = global [10 x [100 x i32]] zeroinitializer
+// More items than the array holds are an error, see globals_long.c.
+
+int counts[1000];
+int primes[1000] = {2, 3, 5, 7, 11};
+float ratios[32] = {0.5, 0.25};
+int short[6] = {1, 2};
+char name[20] = {'c', '1'};
+int grid[10][100];
+
+int sum(int a[1000], int n)
+{
+	int s = 0;
+	int i = 0;
+	while (i < n) {
+		s = s + a[i];
+		i = i + 1;
+	}
+	return s;
+}
+
+int main()
+{
+	print(sum(counts, 1000)); print_space(); print(sum(primes, 1000)); print_space();
+	print(primes[4]); print_space(); print(primes[999]);		// 0 28 11 0
+	print_newline();
+
+	counts[999] = 4;
+	primes[999] = 1;
+	print(sum(counts, 1000) + sum(primes, 1000)); print_space();
+	print(short[1] + short[5]); print_space();
+	print_float(ratios[0] + ratios[1] + ratios[31]);		// 33 2 0.75
+	print_newline();
+
+	print_char(name[0]); print_char(name[1]); print(name[19]); print_space();
+	grid[9][99] = 5;
+	print(grid[0][0] + grid[9][99]);		// c10 5
+	print_newline();
+}
@@ -0,0 +1,14 @@
+extern void print(int c);
+
+// More initializers than the array holds is an error, for globals as for
+// locals.
+//
+//   test/globals_long.c: 9:5: excess elements in array initializer
+//   compiling completed: totally 1 errors, 0 warnings
+
+int g[2] = {1, 2, 3};
+
+int main()
+{
+	print(g[1]);
+}
@@ -0,0 +1,42 @@
+extern void print(int c);
+extern void print_space();
+extern void print_newline();
+
+// Compiled twice with -i by run.sh, which in between patches the first
+// .ll (every 1111 becomes 2222) and edits this file (3333 becomes 4444,
+// and K becomes 6).  A body taken over from the old .ll shows the patch:
+//   kept:      unchanged, body reused, 2223
+//   edited:    body changed, compiled again, 4444
+//   scaled:    uses K, which changed, compiled again, 1111 + 6 * 10
+//   callsKept: unchanged, reused, still calls kept, 2224
+// so the second run prints
+//   2223 4444 1171 2224
+
+const int K = 5;
+
+int kept(int a)
+{
+	return a + 1111;
+}
+
+int edited(int a)
+{
+	return a * 3333;
+}
+
+int scaled(int a)
+{
+	return 1111 + K * a;
+}
+
+int callsKept(int a)
+{
+	return kept(a) + 1;
+}
+
+int main()
+{
+	print(kept(1)); print_space(); print(edited(1)); print_space();
+	print(scaled(10)); print_space(); print(callsKept(1));	// first run: 1112 3333 1161 1113
+	print_newline();
+}
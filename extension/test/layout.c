@@ -0,0 +1,52 @@
+extern void print(int c);
+extern void print_char(char c);
+extern void print_float(float f);
+extern void print_space();
+extern void print_newline();
+
+// Struct layouts are worked out once by the checker and members are found
+// by the index it records; every declarator is a member of its own, array
+// members keep their array type.  Run with -t to see the offsets.
+
+struct inner {
+	char tag;		// offset 0
+	int a, b;		// 4, 8; size 12
+};
+
+struct outer {
+	char c;			// offset 0
+	int v[3];		// 4
+	struct inner in;	// 16
+	float a, b;		// 28, 32, the same names as in struct inner; size 36
+};
+
+int main()
+{
+	struct outer o;
+	struct outer *p = &o;
+	o.c = 'o';
+	o.v[0] = 1; o.v[1] = 2; o.v[2] = 3;
+	o.in.tag = 'i';
+	o.in.a = 10;
+	o.in.b = 20;
+	o.a = 0.5;
+	o.b = 1.5;
+	print_char(p->c); print_char(p->in.tag); print_space();
+	print(p->v[0] + p->v[1] + p->v[2]); print_space();
+	print(p->in.a); print_space(); print(p->in.b); print_space();
+	print_float(p->a + p->b);		// oi 6 10 20 2.00
+	print_newline();
+
+	struct inner items[3];
+	int i = 0;
+	while (i < 3) {
+		items[i].tag = 'a' + i;
+		items[i].a = i;
+		items[i].b = i * i;
+		i = i + 1;
+	}
+	struct inner *q = &items[2];
+	print_char(items[1].tag); print_space(); print(q->a + q->b); print_space();
+	print(items[0].b + items[1].b);		// b 6 1
+	print_newline();
+}
@@ -0,0 +1,69 @@
+extern void print(int c);
+extern void print_float(float f);
+extern void print_space();
+extern void print_newline();
+
+int data[8] = {4, 8, 15, 16, 23, 42, 0, 7};
+
+// index of the first item equal to key, -1 if there is none
+int find(int key)
+{
+	int i = 0;
+	while (i < 8) {
+		if (data[i] == key)
+			return i;
+		i = i + 1;
+	}
+	return -1;
+}
+
+int main()
+{
+	print(find(16)); print_space(); print(find(5));		// 3 -1
+	print_newline();
+
+	// odd items only, stop at the first zero
+	int i = 0;
+	for (;;) {
+		int x = data[i];
+		i++;
+		if (x == 0)
+			break;
+		if (x % 2 == 0)
+			continue;
+		print(x); print_space();		// 15 23
+	}
+	print_newline();
+
+	// continue still runs the step
+	int sum = 0;
+	for (i = 0; i < 8; i++) {
+		if (data[i] > 20)
+			continue;
+		sum += data[i];
+	}
+	print(sum); print_space();		// 50
+	float f = 1;
+	for (i = 10; i > 0; i -= 3)
+		f *= 2;
+	print(i); print_space(); print_float(f);	// -2 16.00
+	print_newline();
+
+	// break and continue leave the innermost loop only
+	int n = 0;
+	i = 0;
+	while (i < 3) {
+		int j = 0;
+		i = i + 1;
+		while (j < 10) {
+			j = j + 1;
+			if (j == i)
+				continue;
+			if (j > 3)
+				break;
+			n = n + 1;
+		}
+	}
+	print(n);		// 6
+	print_newline();
+}
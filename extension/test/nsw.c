@@ -0,0 +1,56 @@
+extern void print(int c);
+extern void print_char(char c);
+extern void print_space();
+extern void print_newline();
+
+// int arithmetic is emitted with nsw and array items with inbounds GEPs,
+// which lets LLVM widen induction variables and fold address arithmetic.
+// run.sh optimizes this file with opt -O2 first; nothing below overflows
+// an int or leaves an array, so the output must be the same as without.
+// char arithmetic is done in int and truncated, so it may still wrap.
+
+int grid[4][5];
+
+int main()
+{
+	// indices computed from induction variables
+	int i = 0;
+	while (i < 4) {
+		int j = 0;
+		while (j < 5) {
+			grid[i][j] = i * 5 + j;
+			j = j + 1;
+		}
+		i = i + 1;
+	}
+	int sum = 0;
+	for (i = 1; i < 20; i++)
+		sum += grid[i / 5][i % 5] - grid[(i - 1) / 5][(i - 1) % 5];
+	print(sum); print_space(); print(grid[3][4]);		// 19 19
+	print_newline();
+
+	// a row walked backwards
+	int v[8];
+	int k = 7;
+	while (k >= 0) {
+		v[k] = -k * 3;
+		k = k - 1;
+	}
+	print(v[7]); print_space(); print(v[0] - v[7]);		// -21 21
+	print_newline();
+
+	// large but not overflowing products, negation
+	int big = 46340;
+	int sq = big * big;
+	int neg = -sq;
+	print(sq); print_space(); print(neg + sq); print_space();
+	print(-2147483647 - 1);		// 2147395600 0 -2147483648
+	print_newline();
+
+	// char wraps when it is stored back
+	char c = 100;
+	char d = c + 100;
+	char e = -c - 100;
+	print(d); print_space(); print(e); print_space(); print(c * 3);	// -56 56 300
+	print_newline();
+}
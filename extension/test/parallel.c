@@ -0,0 +1,117 @@
+extern void print(int c);
+extern void print_newline();
+
+// Function bodies are checked in parallel, one contiguous run of them per
+// processor, after the declarations.  The messages must be the ones the
+// serial checker gives (-t checks serially), whatever the number of
+// processors: checking stops at the first item with an error, so only the
+// error in f6 is reported, not those in f9 and f13 that other threads
+// may have found first.
+//
+//   test/parallel.c: 53:6: use of undeclared identifier
+//   compiling completed: totally 1 errors, 0 warnings
+
+int f0(int a)
+{
+	int x = a * 1;
+	return x + 0;
+}
+
+int f1(int a)
+{
+	int x = a * 2;
+	return x + 1;
+}
+
+int f2(int a)
+{
+	int x = a * 3;
+	return x + 2;
+}
+
+int f3(int a)
+{
+	int x = a * 4;
+	return x + 3;
+}
+
+int f4(int a)
+{
+	int x = a * 5;
+	return x + 4;
+}
+
+int f5(int a)
+{
+	int x = a * 6;
+	return x + 5;
+}
+
+int f6(int a)
+{
+	int x = a * 7;
+	x = undefined6;		// reported
+	return x + 6;
+}
+
+int f7(int a)
+{
+	int x = a * 8;
+	return x + 7;
+}
+
+int f8(int a)
+{
+	int x = a * 9;
+	return x + 8;
+}
+
+int f9(int a)
+{
+	int x = a * 10;
+	x = undefined9;		// not reported
+	return x + 9;
+}
+
+int f10(int a)
+{
+	int x = a * 11;
+	return x + 10;
+}
+
+int f11(int a)
+{
+	int x = a * 12;
+	return x + 11;
+}
+
+int f12(int a)
+{
+	int x = a * 13;
+	return x + 12;
+}
+
+int f13(int a)
+{
+	int x = a * 14;
+	x = f0(1, 2);		// not reported
+	return x + 13;
+}
+
+int f14(int a)
+{
+	int x = a * 15;
+	return x + 14;
+}
+
+int f15(int a)
+{
+	int x = a * 16;
+	return x + 15;
+}
+
+int main()
+{
+	print(f0(1) + f15(2));
+	print_newline();
+}
@@ -0,0 +1,45 @@
+extern void print(int c);
+extern void print_char(char c);
+extern void print_float(float f);
+extern void print_space();
+extern void print_newline();
+
+// the value of a return is converted to the return type of the function
+
+int truncated()
+{
+	return 1.5;
+}
+
+int widened(char c)
+{
+	return c;
+}
+
+float promoted(int i)
+{
+	return i / 2;
+}
+
+char narrowed(int i)
+{
+	return i + 1;
+}
+
+void early(int i)
+{
+	if (i > 0)
+		return;
+	print(i);
+}
+
+int main()
+{
+	print(truncated()); print_space(); print(widened('A'));		// 1 65
+	print_newline();
+	print_float(promoted(7)); print_space(); print_char(narrowed('a'));	// 3.00 b
+	print_newline();
+	early(1); early(-4);		// -4
+	print_newline();
+	return 0;
+}
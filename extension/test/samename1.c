@@ -0,0 +1,37 @@
+extern void print(int c);
+extern void print_space();
+extern void print_newline();
+
+// Compiled in one process with samename2.c, which has another struct node,
+// by run.sh: bin/compiler -r 1000 test/samename1.c test/samename2.c.  Each
+// compile must use its own layout of the struct.
+
+struct node {
+	int key;
+	int value;
+};
+
+int sum(struct node n[3])
+{
+	int s = 0;
+	int i = 0;
+	while (i < 3) {
+		s = s + n[i].key * n[i].value;
+		i = i + 1;
+	}
+	return s;
+}
+
+int main()
+{
+	struct node list[3];
+	int i = 0;
+	while (i < 3) {
+		list[i].key = i + 1;
+		list[i].value = 10 * i;
+		i = i + 1;
+	}
+	struct node *p = &list[2];
+	print(sum(list)); print_space(); print(p->value);		// 80 20
+	print_newline();
+}
@@ -0,0 +1,33 @@
+extern void print(int c);
+extern void print_char(char c);
+extern void print_float(float f);
+extern void print_space();
+extern void print_newline();
+
+// The other half of samename1.c: the same struct name, other members.
+
+struct node {
+	char tag;
+	float weight;
+	int hits[3];
+};
+
+float total(struct node n[2])
+{
+	return n[0].weight * n[0].hits[2] + n[1].weight * n[1].hits[2];
+}
+
+int main()
+{
+	struct node list[2];
+	list[0].tag = 'a';
+	list[0].weight = 0.5;
+	list[0].hits[2] = 4;
+	list[1].tag = 'b';
+	list[1].weight = 1.5;
+	list[1].hits[2] = 2;
+	struct node *p = &list[1];
+	print_char(list[0].tag); print_char(p->tag); print_space();
+	print_float(total(list));		// ab 5.00
+	print_newline();
+}
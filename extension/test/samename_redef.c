@@ -0,0 +1,19 @@
+extern void print(int c);
+
+// Two structs of one name in a file are an error.
+//
+//   test/samename_redef.c: 11:1: redefinition of struct
+//   compiling completed: totally 1 errors, 0 warnings
+
+struct node {
+	int key;
+};
+struct node {
+	float weight;
+};
+
+int main()
+{
+	struct node n;
+	print(0);
+}
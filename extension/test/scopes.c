@@ -0,0 +1,82 @@
+extern void print(int c);
+extern void print_space();
+extern void print_newline();
+
+// Every scope lives in one hashed table; leaving a scope undoes its
+// bindings and brings back the ones they hid.  Scopes nest deeper than
+// the 32 levels the checker used to allow, and enough names are declared
+// in the middle of the nesting that the table grows while outer bindings
+// are hidden.
+
+int x = 1000;
+
+int globalX()
+{
+	return x;
+}
+
+int main()
+{
+	int sum = 0;
+	int x = 0;
+	{ int x = 1; sum = sum + x;
+	{ int x = 2; sum = sum + x;
+	{ int x = 3; sum = sum + x;
+	{ int x = 4; sum = sum + x;
+	{ int x = 5; sum = sum + x;
+	{ int x = 6; sum = sum + x;
+	{ int x = 7; sum = sum + x;
+	{ int x = 8; sum = sum + x;
+	{ int x = 9; sum = sum + x;
+	{ int x = 10; sum = sum + x;
+	{ int x = 11; sum = sum + x;
+	{ int x = 12; sum = sum + x;
+	{ int x = 13; sum = sum + x;
+	{ int x = 14; sum = sum + x;
+	{ int x = 15; sum = sum + x;
+	{ int x = 16; sum = sum + x;
+	{ int x = 17; sum = sum + x;
+	{ int x = 18; sum = sum + x;
+	{ int x = 19; sum = sum + x;
+	{ int x = 20; sum = sum + x;
+		int n0 = 0, n1 = 1, n2 = 2, n3 = 3, n4 = 4, n5 = 5, n6 = 6, n7 = 7;
+		int n8 = 8, n9 = 9, n10 = 10, n11 = 11, n12 = 12, n13 = 13, n14 = 14, n15 = 15;
+		int n16 = 16, n17 = 17, n18 = 18, n19 = 19, n20 = 20, n21 = 21, n22 = 22, n23 = 23;
+		int n24 = 24, n25 = 25, n26 = 26, n27 = 27, n28 = 28, n29 = 29, n30 = 30, n31 = 31;
+		int n32 = 32, n33 = 33, n34 = 34, n35 = 35, n36 = 36, n37 = 37, n38 = 38, n39 = 39;
+		int n40 = 40, n41 = 41, n42 = 42, n43 = 43, n44 = 44, n45 = 45, n46 = 46, n47 = 47;
+		sum = sum + n47 - n40;
+	{ int x = 21; sum = sum + x;
+	{ int x = 22; sum = sum + x;
+	{ int x = 23; sum = sum + x;
+	{ int x = 24; sum = sum + x;
+	{ int x = 25; sum = sum + x;
+	{ int x = 26; sum = sum + x;
+	{ int x = 27; sum = sum + x;
+	{ int x = 28; sum = sum + x;
+	{ int x = 29; sum = sum + x;
+	{ int x = 30; sum = sum + x;
+	{ int x = 31; sum = sum + x;
+	{ int x = 32; sum = sum + x;
+	{ int x = 33; sum = sum + x;
+	{ int x = 34; sum = sum + x;
+	{ int x = 35; sum = sum + x;
+	{ int x = 36; sum = sum + x;
+	{ int x = 37; sum = sum + x;
+	{ int x = 38; sum = sum + x;
+	{ int x = 39; sum = sum + x;
+	{ int x = 40; sum = sum + x;
+		print(x); print_space(); print(sum);		// 40 827
+		print_newline();
+	}}}}}}}}}}}}}}}}}}}}	// back at depth 20
+		int sum2 = x + n3;
+		print(x); print_space(); print(sum2);		// 20 23
+		print_newline();
+	}}}}}}}}}}}}}}}}}}}}
+
+	// everything declared inside is gone again, the outer x is back
+	print(x); print_space(); print(sum);	// 0 827
+	print_newline();
+	print(globalX());			// 1000
+	print_newline();
+}
@@ -0,0 +1,74 @@
+extern void print(int c);
+extern void print_char(char c);
+extern void print_float(float f);
+extern void print_space();
+extern void print_newline();
+
+// Loads and stores carry TBAA tags: struct members get (struct, member
+// type, offset), so members of the same type are told apart by offset, and
+// anything else gets the tag of its type.  Whatever may really alias must
+// still be seen to, the results below hold with or without optimization.
+
+struct Pair {
+	int a;
+	int b;
+	float f;
+	char c;
+};
+
+struct Outer {
+	int x;
+	struct Pair in;
+};
+
+void swap(struct Pair *p)
+{
+	int t = p->a;
+	p->a = p->b;
+	p->b = t;
+}
+
+// q points into *p, to a or to b
+int overwrite(struct Pair *p, int *q)
+{
+	p->a = 1;
+	*q = 5;
+	return p->a + p->b;
+}
+
+// a char may alias anything of char type, here a member
+char viaChar(struct Pair *p, char *c)
+{
+	p->c = 'x';
+	*c = 'y';
+	return p->c;
+}
+
+float scale(struct Outer *o, float *f)
+{
+	o->in.f = 2;
+	*f = *f * 3;
+	o->x = o->x + 1;
+	return o->in.f;
+}
+
+int main()
+{
+	struct Pair s;
+	s.a = 3; s.b = 4;
+	swap(&s);
+	print(s.a); print_space(); print(s.b);		// 4 3
+	print_newline();
+
+	print(overwrite(&s, &s.a)); print_space(); print(overwrite(&s, &s.b));	// 8 6
+	print_newline();
+
+	print_char(viaChar(&s, &s.c));		// y
+	print_newline();
+
+	struct Outer o;
+	o.x = 41;
+	print_float(scale(&o, &o.in.f)); print_space(); print(o.x);	// 6.00 42
+	print_newline();
+	return 0;
+}
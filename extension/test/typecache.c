@@ -0,0 +1,102 @@
+extern void print(int c);
+extern void print_char(char c);
+extern void print_float(float f);
+extern void print_space();
+extern void print_newline();
+
+// Types written out again in different places are the same type: the
+// lowered LLVM types are cached by structure, not by where the type was
+// declared, so each of these lowers to one type.
+
+struct point {
+	int x;
+	int y;
+};
+
+int sum(int m[2][3])
+{
+	int s = 0;
+	int i = 0;
+	while (i < 2) {
+		int j = 0;
+		while (j < 3) {
+			s = s + m[i][j];
+			j = j + 1;
+		}
+		i = i + 1;
+	}
+	return s;
+}
+
+int add(int a, int b)
+{
+	return a + b;
+}
+
+int mul(int a, int b)
+{
+	return a * b;
+}
+
+int apply(int (*op)(int a, int b), int a, int b)
+{
+	return op(a, b);
+}
+
+float scale(float (*f)(float v), float v)
+{
+	return f(v) * 2;
+}
+
+float half(float v)
+{
+	return v / 2;
+}
+
+struct point move(struct point p, int d)
+{
+	p.x = p.x + d;
+	p.y = p.y - d;
+	return p;
+}
+
+int main()
+{
+	int a[2][3];
+	int b[2][3];
+	int i = 0;
+	while (i < 3) {
+		a[0][i] = i;
+		a[1][i] = 10 * i;
+		b[0][i] = 1;
+		b[1][i] = 2;
+		i = i + 1;
+	}
+	print(sum(a));
+	print_space();
+	print(sum(b));
+	print_newline();			// 33 9
+
+	int (*f)(int a, int b) = add;
+	int (*g)(int x, int y) = mul;
+	print(apply(f, 6, 7));
+	print_space();
+	print(apply(g, 6, 7));
+	print_space();
+	f = g;
+	print(apply(f, 3, 3));
+	print_newline();			// 13 42 9
+
+	print_float(scale(half, 3));
+	print_newline();			// 3.00
+
+	struct point p;
+	struct point *q = &p;
+	p.x = 1;
+	p.y = 2;
+	struct point r = move(*q, 5);
+	print(r.x);
+	print_space();
+	print(r.y);
+	print_newline();			// 6 -3
+}
@@ -0,0 +1,74 @@
+extern void print(int c);
+extern void print_space();
+extern void print_newline();
+
+// Statements that can never run are pruned after checking, with one
+// warning at the first of them; the branches of folded conditions are
+// pruned without one.  Expected warnings ("code will never be executed"):
+//   line 18, line 33, line 45, line 55
+// and no others.
+
+const int VERBOSE = 0;
+
+int afterReturn(int x)
+{
+	if (x > 0)
+		return 1;
+	return 0;
+	print(x);		// line 18, warned
+	x = x + 1;		// same block, not warned again
+}
+
+int afterBreak()
+{
+	int i = 0;
+	int n = 0;
+	while (i < 10) {
+		i = i + 1;
+		if (i == 3)
+			continue;
+		n = n + i;
+		if (n > 10) {
+			break;
+			n = 0;		// line 33, warned
+		}
+	}
+	return n;
+}
+
+int bothReturn(int x)
+{
+	if (x > 5)
+		return 5;
+	else
+		return x;
+	print(x);		// line 45, warned
+}
+
+int loopForever(int x)
+{
+	for (;;) {
+		x = x * 2;
+		if (x > 100)
+			return x;
+	}
+	print(x);		// line 55, warned: the loop is only left by returning
+}
+
+int main()
+{
+	print(afterReturn(3)); print_space(); print(afterBreak()); print_space();
+	print(bothReturn(9)); print_space(); print(loopForever(3));	// 1 12 5 192
+	print_newline();
+
+	// folded conditions: pruned without a warning
+	if (VERBOSE > 0)
+		print(-1);
+	while (VERBOSE > 1)
+		print(-2);
+	if (VERBOSE == 0)
+		print(7);
+	else
+		print(-3);
+	print_newline();		// 7
+}